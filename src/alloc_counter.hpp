@@ -0,0 +1,68 @@
+// count heap allocations of each thread
+#ifndef __ALLOC_COUNTER_HPP__
+#define __ALLOC_COUNTER_HPP__
+
+#include <cstdlib>
+#include <new>
+
+// replaces global operator new, so it must be included by
+//  only one source file of a program
+// allocations of other threads, such as the thread pool of
+//  a Solver, are counted by those threads
+inline long long &heapAllocCounter()
+{
+    thread_local long long cnt = 0;
+    return cnt;
+}
+
+// # of heap allocations made by this thread so far
+inline long long heapAllocCount()
+{
+    return heapAllocCounter();
+}
+
+// once these are inlined, gcc warns that free() releases a
+//  block of operator new, which is right as new calls malloc()
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(std::size_t size)
+{
+    heapAllocCounter()++;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+#endif
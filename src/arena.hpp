@@ -0,0 +1,138 @@
+// scratch memory of a move, released at once
+#ifndef __ARENA_HPP__
+#define __ARENA_HPP__
+
+#include "common.h"
+
+#include <cstddef>
+#include <memory>
+
+// bump allocator: allocate() takes the next bytes of the
+//  current chunk, reset() releases everything at once
+// chunks are kept by reset(), so once moves have reached
+//  their peak, later moves take nothing from heap
+// a move outgrowing its chunk adds one twice as large, and
+//  reset() replaces them with a single chunk of the peak
+// nothing is ever freed or destructed before reset(), so
+//  it only holds trivial values, and a growing vector leaves
+//  its old buffers behind
+class Arena
+{
+private:
+    static const size_t ALIGN = alignof(std::max_align_t);
+    static const size_t MIN_CHUNK = 64 << 10;
+
+    struct Chunk
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    vector<Chunk> chunks;
+    size_t top = 0;  // bytes used in the last chunk
+    size_t used = 0; // bytes used since reset()
+    size_t peak = 0; // largest used
+    long long heap_cnt = 0;
+
+    void addChunk(size_t size)
+    {
+        chunks.push_back(Chunk{std::unique_ptr<char[]>(new char[size]), size});
+        top = 0;
+        heap_cnt++;
+    }
+
+public:
+    void *allocate(size_t bytes)
+    {
+        bytes = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+        if (chunks.empty() || top + bytes > chunks.back().size)
+        {
+            size_t size = chunks.empty() ? MIN_CHUNK : 2 * chunks.back().size;
+            addChunk(max(bytes, size));
+        }
+        void *p = chunks.back().data.get() + top;
+        top += bytes;
+        used += bytes;
+        peak = max(peak, used);
+        return p;
+    }
+
+    // release all allocations
+    void reset()
+    {
+        if (chunks.size() > 1)
+        {
+            chunks.clear();
+            addChunk(peak);
+        }
+        top = used = 0;
+    }
+
+    // bytes allocated since reset()
+    size_t getUsedBytes() const
+    {
+        return used;
+    }
+
+    // most bytes allocated between two reset()
+    size_t getPeakBytes() const
+    {
+        return peak;
+    }
+
+    // # of chunks taken from heap
+    long long getHeapCount() const
+    {
+        return heap_cnt;
+    }
+};
+
+// allocator of std containers in an arena
+//  the arena must outlive the containers
+template <class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    Arena *arena;
+
+    ArenaAllocator(Arena &arena)
+        : arena(&arena)
+    {
+    }
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other)
+        : arena(other.arena)
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(arena->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *, size_t)
+    {
+    }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U> &other) const
+    {
+        return arena == other.arena;
+    }
+
+    template <class U>
+    bool operator!=(const ArenaAllocator<U> &other) const
+    {
+        return arena != other.arena;
+    }
+};
+
+// vector in an arena, constructed with the arena
+//  as its allocator: ArenaVector<int> v(arena)
+template <class T>
+using ArenaVector = vector<T, ArenaAllocator<T>>;
+
+#endif
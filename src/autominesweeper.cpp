@@ -0,0 +1,219 @@
+#define AMS_BUILD
+#include "autominesweeper.h"
+#include "solver.hpp"
+
+#include <new>
+
+struct ams_solver
+{
+    Solver solver;
+    int height = 0, width = 0;
+
+    ams_solver(unsigned long long seed) : solver(seed)
+    {
+    }
+};
+
+// copy blocks to out, return false if there is no room
+static bool writeBlocks(const vector<Block> &blocks,
+                        int *out, int max_cnt, int *cnt)
+{
+    *cnt = blocks.size();
+    if (*cnt > max_cnt)
+        return false;
+    for (int i = 0; i < *cnt; ++i)
+    {
+        out[2 * i] = blocks[i].first;
+        out[2 * i + 1] = blocks[i].second;
+    }
+    return true;
+}
+
+// solve and write results
+static int answer(ams_solver *s,
+                  int *steps, int max_steps, int *step_cnt,
+                  int *flags, int max_flags, int *flag_cnt)
+{
+    s->solver.solve();
+    bool ok = writeBlocks(s->solver.getNextSteps(),
+                          steps, max_steps, step_cnt);
+    ok = writeBlocks(s->solver.getNextFlags(),
+                     flags, max_flags, flag_cnt) &&
+         ok;
+    return ok ? AMS_OK : AMS_BUFFER_TOO_SMALL;
+}
+
+static bool badOutput(int *steps, int max_steps, int *step_cnt,
+                      int *flags, int max_flags, int *flag_cnt)
+{
+    return !step_cnt || !flag_cnt || max_steps < 0 || max_flags < 0 ||
+           (max_steps > 0 && !steps) || (max_flags > 0 && !flags);
+}
+
+ams_solver *ams_create(unsigned long long seed)
+{
+    return new (std::nothrow) ams_solver(seed);
+}
+
+void ams_destroy(ams_solver *solver)
+{
+    delete solver;
+}
+
+int ams_set_threads(ams_solver *solver, int thread_num)
+{
+    if (!solver || thread_num < 1)
+        return AMS_BAD_ARGUMENT;
+    try
+    {
+        solver->solver.setThreads(thread_num);
+    }
+    catch (...)
+    {
+        return AMS_INTERNAL_ERROR;
+    }
+    return AMS_OK;
+}
+
+int ams_set_time_budget(ams_solver *solver, double budget_ms)
+{
+    if (!solver || !(budget_ms >= 0))
+        return AMS_BAD_ARGUMENT;
+    solver->solver.setTimeBudget(budget_ms / 1e3);
+    return AMS_OK;
+}
+
+int ams_set_lookahead(ams_solver *solver, double lookahead_ms, int depth)
+{
+    if (!solver || !(lookahead_ms >= 0) || depth < 1)
+        return AMS_BAD_ARGUMENT;
+    try
+    {
+        solver->solver.setLookahead(lookahead_ms / 1e3, depth);
+    }
+    catch (...)
+    {
+        return AMS_INTERNAL_ERROR;
+    }
+    return AMS_OK;
+}
+
+int ams_get_last_status(const ams_solver *solver,
+                        int *exact, double *used_ms)
+{
+    if (!solver)
+        return AMS_BAD_ARGUMENT;
+    if (exact)
+        *exact = solver->solver.isExact();
+    if (used_ms)
+        *used_ms = solver->solver.getTimeUsed() * 1e3;
+    return AMS_OK;
+}
+
+int ams_set_metrics(ams_solver *solver, int on)
+{
+    if (!solver)
+        return AMS_BAD_ARGUMENT;
+    solver->solver.setMetrics(on != 0);
+    return AMS_OK;
+}
+
+int ams_get_last_stats(const ams_solver *solver,
+                       char *json, int max_len, int *len)
+{
+    if (!solver || !len || max_len < 0 || (max_len > 0 && !json))
+        return AMS_BAD_ARGUMENT;
+    try
+    {
+        string s = "{\"move\":" + solver->solver.getLastStats().toJson() +
+                   ",\"game\":" + solver->solver.getGameStats().toJson() + '}';
+        *len = s.size();
+        if (*len + 1 > max_len)
+            return AMS_BUFFER_TOO_SMALL;
+        std::copy(s.begin(), s.end(), json);
+        json[*len] = 0;
+    }
+    catch (...)
+    {
+        return AMS_INTERNAL_ERROR;
+    }
+    return AMS_OK;
+}
+
+int ams_solve(ams_solver *solver, const int *board,
+              int height, int width, int total_mine,
+              int *steps, int max_steps, int *step_cnt,
+              int *flags, int max_flags, int *flag_cnt)
+{
+    if (!solver || !board ||
+        !Solver::isValidSize(height, width, total_mine) ||
+        badOutput(steps, max_steps, step_cnt, flags, max_flags, flag_cnt))
+        return AMS_BAD_ARGUMENT;
+    for (long long k = 0; k < (long long)height * width; ++k)
+        if (!Solver::isValidType(board[k]))
+            return AMS_BAD_ARGUMENT;
+    try
+    {
+        solver->height = 0;
+        solver->solver.readBoard(board, height, width, total_mine);
+        solver->height = height;
+        solver->width = width;
+        return answer(solver, steps, max_steps, step_cnt,
+                      flags, max_flags, flag_cnt);
+    }
+    catch (...)
+    {
+        return AMS_INTERNAL_ERROR;
+    }
+}
+
+int ams_new_game(ams_solver *solver,
+                 int height, int width, int total_mine)
+{
+    if (!solver || !Solver::isValidSize(height, width, total_mine))
+        return AMS_BAD_ARGUMENT;
+    try
+    {
+        solver->height = 0;
+        solver->solver.newGame(height, width, total_mine);
+        solver->height = height;
+        solver->width = width;
+    }
+    catch (...)
+    {
+        return AMS_INTERNAL_ERROR;
+    }
+    return AMS_OK;
+}
+
+int ams_update(ams_solver *solver,
+               const int *changes, int change_cnt,
+               int *steps, int max_steps, int *step_cnt,
+               int *flags, int max_flags, int *flag_cnt)
+{
+    if (!solver || solver->height == 0 || change_cnt < 0 ||
+        (change_cnt > 0 && !changes) ||
+        badOutput(steps, max_steps, step_cnt, flags, max_flags, flag_cnt))
+        return AMS_BAD_ARGUMENT;
+    for (int i = 0; i < change_cnt; ++i)
+    {
+        int x = changes[3 * i], y = changes[3 * i + 1];
+        if (x < 0 || x >= solver->height || y < 0 || y >= solver->width ||
+            !Solver::isValidType(changes[3 * i + 2]))
+            return AMS_BAD_ARGUMENT;
+    }
+    try
+    {
+        vector<Change> delta(change_cnt);
+        for (int i = 0; i < change_cnt; ++i)
+            delta[i] = make_pair(make_pair(changes[3 * i], changes[3 * i + 1]),
+                                 changes[3 * i + 2]);
+        solver->solver.updateBoard(delta);
+        return answer(solver, steps, max_steps, step_cnt,
+                      flags, max_flags, flag_cnt);
+    }
+    catch (...)
+    {
+        return AMS_INTERNAL_ERROR;
+    }
+}
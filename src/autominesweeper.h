@@ -0,0 +1,110 @@
+/* C interface of the solver, built as libautominesweeper
+ *  g++ -O2 -shared -fPIC -fvisibility=hidden -pthread
+ *      autominesweeper.cpp -o libautominesweeper.so
+ * types of blocks are the same as board.txt
+ *  0-8: # of mines nearby, 16: mine, 32: flag, 64: unknown
+ *  other types are rejected with AMS_BAD_ARGUMENT
+ * boards have at most 65536 rows and columns and 2^26 blocks,
+ *  and no more mines than blocks, other sizes are rejected
+ *  with AMS_BAD_ARGUMENT
+ * blocks are returned as pairs (row, column) in int arrays
+ * functions return AMS_OK or one of the errors below
+ * a handle must not be used by two threads at the same time
+ */
+#ifndef __AUTOMINESWEEPER_H__
+#define __AUTOMINESWEEPER_H__
+
+#ifdef _WIN32
+#ifdef AMS_BUILD
+#define AMS_API __declspec(dllexport)
+#else
+#define AMS_API __declspec(dllimport)
+#endif
+#else
+#define AMS_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    enum
+    {
+        AMS_OK = 0,
+        AMS_BAD_ARGUMENT = -1,
+        AMS_BUFFER_TOO_SMALL = -2, /* counts are set to the sizes needed */
+        AMS_INTERNAL_ERROR = -3
+    };
+
+    typedef struct ams_solver ams_solver;
+
+    /* NULL on failure */
+    AMS_API ams_solver *ams_create(unsigned long long seed);
+    AMS_API void ams_destroy(ams_solver *solver);
+
+    /* count partitions on thread_num threads, 1 by default */
+    AMS_API int ams_set_threads(ams_solver *solver, int thread_num);
+
+    /* limit each solve to budget_ms milliseconds, 0 for no limit
+     *  partitions not counted in time are estimated roughly
+     */
+    AMS_API int ams_set_time_budget(ams_solver *solver, double budget_ms);
+
+    /* before guessing, compare the safest blocks for at most
+     *  lookahead_ms milliseconds by the chance to survive this
+     *  guess and depth - 1 more, 0 to guess the safest block
+     */
+    AMS_API int ams_set_lookahead(ams_solver *solver, double lookahead_ms,
+                                  int depth);
+
+    /* status of the last solve
+     *  exact: 0 if some partitions were estimated, otherwise 1
+     *  used_ms: time used in milliseconds
+     *  either of them may be NULL
+     */
+    AMS_API int ams_get_last_status(const ams_solver *solver,
+                                    int *exact, double *used_ms);
+
+    /* record statistics of each move if on is not 0 */
+    AMS_API int ams_set_metrics(ams_solver *solver, int on);
+
+    /* statistics of the last move and of the game so far
+     *  as JSON {"move":{...},"game":{...}}, see metrics.hpp
+     *  json: room for max_len chars including the ending 0
+     *  len: length of the JSON without the ending 0
+     */
+    AMS_API int ams_get_last_stats(const ams_solver *solver,
+                                   char *json, int max_len, int *len);
+
+    /* solve a whole board
+     *  board: height*width types in row-major order, read in place
+     *  steps: room for max_steps blocks to click
+     *  flags: room for max_flags blocks to put flags on
+     *  step_cnt, flag_cnt: # of blocks written
+     */
+    AMS_API int ams_solve(ams_solver *solver, const int *board,
+                          int height, int width, int total_mine,
+                          int *steps, int max_steps, int *step_cnt,
+                          int *flags, int max_flags, int *flag_cnt);
+
+    /* start a game on an empty board, then use ams_update()
+     *  after a failed ams_new_game() or ams_solve(), ams_update()
+     *  is rejected until one of them succeeds
+     */
+    AMS_API int ams_new_game(ams_solver *solver,
+                             int height, int width, int total_mine);
+
+    /* apply change_cnt changed blocks as (row, column, type)
+     *  and solve, outputs are the same as ams_solve()
+     */
+    AMS_API int ams_update(ams_solver *solver,
+                           const int *changes, int change_cnt,
+                           int *steps, int max_steps, int *step_cnt,
+                           int *flags, int max_flags, int *flag_cnt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
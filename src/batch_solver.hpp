@@ -0,0 +1,182 @@
+// solve many independent boards in one call
+#ifndef __BATCH_SOLVER_HPP__
+#define __BATCH_SOLVER_HPP__
+
+#include "common.h"
+#include "utils.hpp"
+#include "solver.hpp"
+#include "thread_pool.hpp"
+
+#include <memory>
+
+// boards in structure-of-arrays layout
+//  board i is height[i] x width[i] with total_mine[i] mines,
+//  its types start at cells + offset[i] in row-major order
+//  types are the same as board.txt
+// the arrays belong to the caller and are read in place
+struct BoardBatch
+{
+    int count = 0;
+    const int *height = nullptr;
+    const int *width = nullptr;
+    const int *total_mine = nullptr;
+    const long long *offset = nullptr;
+    const int *cells = nullptr;
+};
+
+// next moves of all boards in contiguous buffers
+//  blocks to click of board i are pairs (x, y) at
+//  steps[2*step_begin[i] ... 2*step_begin[i+1]), flags alike
+//  exact[i] is 0 if board i was guessed with estimates
+struct BatchResult
+{
+    vector<int> step_begin, flag_begin; // count + 1 entries
+    vector<int> steps, flags;
+    vector<char> exact;
+};
+
+// solve boards of a batch on threads
+//  each thread keeps one Solver for all its boards, so grids,
+//  bit planes and cached partition counts are reused
+// boards are handed out in chunks, a board with safe blocks or
+//  mines found by detectSafe() / detectUnsafe() costs a few us,
+//  and threads idle after their cheap boards steal boards still
+//  waiting for enumeration
+// chunk c is solved with seed splitMix64(seed + c), boards of
+//  a chunk in order, so results do not depend on # of threads
+//  (seeding a generator costs about as much as an easy board,
+//  so it is not done per board)
+class BatchSolver
+{
+private:
+    // boards per task
+    static const int CHUNK = 16;
+
+    // results of a chunk, copied to BatchResult at the end
+    struct Chunk
+    {
+        vector<int> step_cnt, flag_cnt;
+        vector<int> steps, flags;
+        vector<char> exact;
+    };
+
+    unsigned long long seed;
+    std::unique_ptr<ThreadPool> pool;
+    // one solver per thread, see ThreadPool::threadIndex()
+    vector<std::unique_ptr<Solver>> solvers;
+    // kept across calls
+    vector<Chunk> chunks;
+
+    static void appendBlocks(const vector<Block> &blocks, vector<int> &out)
+    {
+        for (const auto &it : blocks)
+        {
+            out.push_back(it.first);
+            out.push_back(it.second);
+        }
+    }
+
+    void solveChunk(const BoardBatch &batch, int c, Solver &solver)
+    {
+        Chunk &chunk = chunks[c];
+        chunk.step_cnt.clear();
+        chunk.flag_cnt.clear();
+        chunk.steps.clear();
+        chunk.flags.clear();
+        chunk.exact.clear();
+        int end = min(batch.count, (c + 1) * CHUNK);
+        solver.setSeed(splitMix64(seed + c));
+        for (int i = c * CHUNK; i < end; ++i)
+        {
+            solver.readBoard(batch.cells + batch.offset[i],
+                             batch.height[i], batch.width[i],
+                             batch.total_mine[i]);
+            solver.solve();
+            chunk.step_cnt.push_back(solver.getNextSteps().size());
+            chunk.flag_cnt.push_back(solver.getNextFlags().size());
+            appendBlocks(solver.getNextSteps(), chunk.steps);
+            appendBlocks(solver.getNextFlags(), chunk.flags);
+            chunk.exact.push_back(solver.isExact());
+        }
+    }
+
+public:
+    // solve on thread_num threads, 1 to solve in the calling thread
+    BatchSolver(int thread_num = 1, unsigned long long seed = time(0))
+        : seed(seed)
+    {
+        if (thread_num > 1)
+            pool.reset(new ThreadPool(thread_num));
+        // the calling thread also solves boards while waiting
+        solvers.resize(pool ? thread_num + 1 : 1);
+        for (auto &it : solvers)
+            it.reset(new Solver(seed));
+    }
+
+    // seed of boards in later calls
+    void setSeed(unsigned long long seed)
+    {
+        this->seed = seed;
+    }
+
+    // options of every Solver, see Solver::setTimeBudget()
+    //  and Solver::setCacheLimit()
+    void setTimeBudget(double seconds)
+    {
+        for (auto &it : solvers)
+            it->setTimeBudget(seconds);
+    }
+
+    void setCacheLimit(size_t limit)
+    {
+        for (auto &it : solvers)
+            it->setCacheLimit(limit);
+    }
+
+    // solve all boards of batch, result is overwritten
+    void solve(const BoardBatch &batch, BatchResult &result)
+    {
+        int chunk_num = (batch.count + CHUNK - 1) / CHUNK;
+        if (chunks.size() < chunk_num)
+            chunks.resize(chunk_num);
+        if (pool)
+        {
+            for (int c = 0; c < chunk_num; ++c)
+                pool->submit([this, &batch, c]
+                             { solveChunk(batch, c, *solvers[pool->threadIndex()]); });
+            pool->wait();
+        }
+        else
+            for (int c = 0; c < chunk_num; ++c)
+                solveChunk(batch, c, *solvers[0]);
+
+        // prefix sums of counts, then copy blocks
+        result.step_begin.assign(1, 0);
+        result.flag_begin.assign(1, 0);
+        result.exact.clear();
+        for (int c = 0; c < chunk_num; ++c)
+        {
+            const Chunk &chunk = chunks[c];
+            for (int k = 0; k < chunk.step_cnt.size(); ++k)
+            {
+                result.step_begin.push_back(result.step_begin.back() + chunk.step_cnt[k]);
+                result.flag_begin.push_back(result.flag_begin.back() + chunk.flag_cnt[k]);
+            }
+            result.exact.insert(result.exact.end(),
+                                chunk.exact.begin(), chunk.exact.end());
+        }
+        result.steps.resize(2 * result.step_begin.back());
+        result.flags.resize(2 * result.flag_begin.back());
+        for (int c = 0; c < chunk_num; ++c)
+        {
+            const Chunk &chunk = chunks[c];
+            int first = c * CHUNK;
+            std::copy(chunk.steps.begin(), chunk.steps.end(),
+                      result.steps.begin() + 2 * result.step_begin[first]);
+            std::copy(chunk.flags.begin(), chunk.flags.end(),
+                      result.flags.begin() + 2 * result.flag_begin[first]);
+        }
+    }
+};
+
+#endif
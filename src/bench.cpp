@@ -0,0 +1,512 @@
+#include "common.h"
+#include "designer.hpp"
+#include "solver.hpp"
+#include "batch_solver.hpp"
+#include "alloc_counter.hpp"
+
+#include <map>
+
+// benchmark of Solver::solve() on a fixed corpus of boards
+// usage: bench [--corpus FILE] [--iterations N] [--min-ms X]
+//              [--save FILE] [--compare FILE] [--tolerance X]
+//              [--generate FILE] [--batch N [--threads T]]
+//  --corpus: boards to solve, default to bench/corpus_v2.txt
+//  --iterations: times each board is solved, default to 50
+//  --min-ms: keep solving a board until X ms are spent,
+//   small boards are too fast for a stable median in
+//   a few iterations, default to 100
+//  --save: write results as a baseline
+//  --compare: compare results with a baseline, exit with 1
+//   if some board regressed
+//  --tolerance: allowed slowdown of median time and growth
+//   of search nodes, default to 0.1 (10%), times must also
+//   slow down by more than their noise, and are not compared
+//   on boards timed for less than MIN_COMPARE_NS
+//  --generate: write a new corpus by self-play and exit
+//  --batch: throughput of BatchSolver in boards/sec on N boards
+//   drawn from the corpus in turn, on T threads (default 1),
+//   against one Solver solving them one by one
+// each board is solved by a Solver with the same seed and no
+//  partition cache, so every iteration does the same work
+//  and counters do not depend on the machine
+// allocs is # of heap allocations of the last iteration,
+//  0 once the solver has warmed up, scratch is the peak of
+//  its arena in KB
+
+// corpus file
+//  corpus V         version, baselines of other versions
+//                   can not be compared
+//  board NAME       then the board in the format of board.txt
+//  H W M            height, width and # of mines
+//  H*W types        row-major
+const int CORPUS_VERSION = 2;
+const unsigned long long SOLVER_SEED = 1;
+const double MIN_SLOWDOWN_NS = 1000;
+const double MIN_COMPARE_NS = 50e6;
+
+struct Snapshot
+{
+    string name;
+    int height, width, total_mine;
+    vector<int> cells;
+};
+
+// result of a board
+struct Result
+{
+    string name;
+    double median_ns = 0, p99_ns = 0;
+    // interquartile range over median, the noise of times
+    double noise = 0;
+    double timed_ns = 0; // sum of times
+    SolveStats stats;    // of one iteration
+    long long allocs = 0; // heap allocations of the last iteration
+    size_t scratch_peak = 0;
+};
+
+vector<Snapshot> readCorpus(const string &file_name)
+{
+    ifstream fin(file_name);
+    if (!fin.is_open())
+        printError("Corpus Not Found!");
+    string tag;
+    int version;
+    if (!(fin >> tag >> version) || tag != "corpus")
+        printError("Bad Corpus!");
+    if (version != CORPUS_VERSION)
+        printError("Corpus Version " + std::to_string(version) +
+                   " Is Not Supported!");
+    vector<Snapshot> corpus;
+    while (fin >> tag)
+    {
+        if (tag != "board")
+            printError("Bad Corpus!");
+        Snapshot s;
+        fin >> s.name >> s.height >> s.width >> s.total_mine;
+        s.cells.resize(s.height * s.width);
+        for (auto &it : s.cells)
+            fin >> it;
+        if (!fin)
+            printError("Incomplete Board " + s.name);
+        corpus.push_back(s);
+    }
+    return corpus;
+}
+
+// value at quantile q of sorted values, nearest rank
+double percentile(const vector<long long> &sorted, double q)
+{
+    int rank = max(1, (int)std::ceil(q * sorted.size()));
+    return sorted[rank - 1];
+}
+
+Result runSnapshot(const Snapshot &s, int iterations, double min_time)
+{
+    static const int WARMUP = 5;
+    Solver solver;
+    solver.setCacheLimit(0);
+    solver.setMetrics(true);
+    vector<long long> times;
+    long long allocs = 0;
+    Timer total;
+    // first runs warm up memory of the solver
+    for (int it = -WARMUP; it < iterations || total.elapsed() < min_time; ++it)
+    {
+        solver.setSeed(SOLVER_SEED);
+        allocs = heapAllocCount();
+        solver.readBoard(s.cells.data(), s.height, s.width, s.total_mine);
+        Timer timer;
+        solver.solve();
+        allocs = heapAllocCount() - allocs;
+        if (it >= 0)
+            times.push_back(timer.elapsedNs());
+        else
+            total.reset();
+    }
+    std::sort(times.begin(), times.end());
+    Result res;
+    res.name = s.name;
+    res.median_ns = percentile(times, 0.5);
+    res.p99_ns = percentile(times, 0.99);
+    res.noise = (percentile(times, 0.75) - percentile(times, 0.25)) /
+                max(res.median_ns, 1.0);
+    for (long long it : times)
+        res.timed_ns += it;
+    res.stats = solver.getLastStats();
+    res.allocs = allocs;
+    res.scratch_peak = solver.getScratchPeak();
+    return res;
+}
+
+// baseline file
+//  corpus V
+//  NAME median_ns p99_ns nodes noise, one line per board
+void saveBaseline(const string &file_name, const vector<Result> &results)
+{
+    ofstream fout(file_name);
+    if (!fout.is_open())
+        printError("Can't Open Baseline File!");
+    fout << "corpus " << CORPUS_VERSION << '\n'
+         << std::fixed << std::setprecision(0);
+    for (const auto &it : results)
+        fout << it.name << ' ' << it.median_ns << ' ' << it.p99_ns
+             << ' ' << it.stats.node_cnt << ' '
+             << std::setprecision(4) << it.noise
+             << std::setprecision(0) << '\n';
+}
+
+// compare with baseline, return # of regressions
+//  a board regresses if its search nodes grow by more than
+//  tolerance, or its median time grows by more than tolerance
+//  plus the larger noise of the two runs and is also
+//  MIN_SLOWDOWN_NS slower, changes of the fastest boards
+//  are within noise of the timer
+// times of boards timed for less than MIN_COMPARE_NS in
+//  this run are only shown, short runs are mostly noise
+int compareBaseline(const string &file_name, const vector<Result> &results,
+                    double tolerance)
+{
+    ifstream fin(file_name);
+    if (!fin.is_open())
+        printError("Baseline Not Found!");
+    string tag;
+    int version;
+    if (!(fin >> tag >> version) || tag != "corpus" ||
+        version != CORPUS_VERSION)
+        printError("Baseline Is Not for Corpus Version " +
+                   std::to_string(CORPUS_VERSION));
+    struct Base
+    {
+        double median_ns, p99_ns;
+        long long node_cnt;
+        double noise;
+    };
+    std::map<string, Base> base;
+    string name;
+    Base b;
+    while (fin >> name >> b.median_ns >> b.p99_ns >> b.node_cnt >> b.noise)
+        base[name] = b;
+
+    int regression = 0;
+    std::cout << "\ncompare with " << file_name
+              << " (tolerance " << tolerance * 100 << "%)\n"
+              << std::left << std::setw(24) << "board"
+              << std::right << std::setw(10) << "median"
+              << std::setw(10) << "p99"
+              << std::setw(10) << "nodes" << '\n';
+    for (const auto &it : results)
+    {
+        auto found = base.find(it.name);
+        if (found == base.end())
+        {
+            std::cout << std::left << std::setw(24) << it.name
+                      << std::right << "  new board\n";
+            continue;
+        }
+        const Base &old = found->second;
+        double median = it.median_ns / max(old.median_ns, 1.0);
+        double p99 = it.p99_ns / max(old.p99_ns, 1.0);
+        double nodes = (it.stats.node_cnt + 1.0) / (old.node_cnt + 1.0);
+        bool timed = it.timed_ns >= MIN_COMPARE_NS;
+        double noise = max(it.noise, old.noise);
+        bool slow = (timed && median > 1 + tolerance + noise &&
+                     it.median_ns - old.median_ns > MIN_SLOWDOWN_NS) ||
+                    nodes > 1 + tolerance;
+        regression += slow;
+        std::cout << std::left << std::setw(24) << it.name << std::right
+                  << std::setw(9) << median << 'x'
+                  << std::setw(9) << p99 << 'x'
+                  << std::setw(9) << nodes << 'x'
+                  << (slow ? "  REGRESSION" : "")
+                  << (timed ? "" : "  (short run, time not compared)") << '\n';
+    }
+    std::cout << regression << " regression(s)" << std::endl;
+    return regression;
+}
+
+// boards of the corpus are taken from self-play
+//  count boards from games with seeds from seed on, each is
+//  a board where at least revealed of the board is known
+//  FIRST: the first such board of the game
+//  MOST_NODES: the one searched with most nodes
+//  MOST_PARTITIONS: the one with most partitions
+// except for FIRST, a board only qualifies if the solver
+//  searches at least MIN_NODES nodes on it, most boards are
+//  settled by detection and deduction and would not time the
+//  counters at all
+// games lost before any board qualifies are skipped
+enum Pick
+{
+    FIRST,
+    MOST_NODES,
+    MOST_PARTITIONS
+};
+const long long MIN_NODES = 8;
+
+struct Spec
+{
+    string name;
+    int width, height, mine_number;
+    double revealed;
+    Pick pick;
+    int count;
+    unsigned long long seed;
+};
+
+const Spec SPECS[] = {
+    {"beginner-opening", 9, 9, 10, 0.1, FIRST, 2, 100},
+    {"intermediate-opening", 16, 16, 40, 0.1, FIRST, 2, 200},
+    {"expert-opening", 30, 16, 99, 0.1, FIRST, 2, 300},
+    {"expert-midgame", 30, 16, 99, 0.2, MOST_NODES, 3, 400},
+    {"expert-late", 30, 16, 99, 0.7, MOST_NODES, 3, 500},
+    {"dense-midgame", 30, 16, 140, 0.2, MOST_NODES, 3, 600},
+    {"dense-large", 64, 64, 900, 0.2, MOST_NODES, 2, 700},
+    {"late-many-partitions", 100, 100, 1800, 0.6, MOST_PARTITIONS, 2, 800},
+    {"huge-midgame", 200, 200, 7600, 0.3, MOST_PARTITIONS, 1, 900},
+};
+
+// play a game of spec with seed, write the board picked
+//  return false if no board qualifies
+bool snapshotGame(const Spec &spec, unsigned long long seed,
+                  const string &name, ofstream &fout)
+{
+    Designer designer(spec.width, spec.height, spec.mine_number, seed);
+    designer.initBoard();
+    // counts of previous moves would hide the work
+    Solver solver(splitMix64(seed));
+    solver.setCacheLimit(0);
+    solver.setMetrics(true);
+    int cells = spec.width * spec.height;
+    bool is_first = true;
+    long long best_score = -1;
+    vector<vector<int>> best;
+    while (!designer.isFinished())
+    {
+        const auto &view = designer.getBoard();
+        solver.readBoard(view, spec.mine_number);
+        solver.solve();
+        const SolveStats &stats = solver.getLastStats();
+        int known = 0;
+        for (const auto &row : view)
+            for (int it : row)
+                known += it <= 8;
+        if (known > 0 && known >= spec.revealed * cells &&
+            (spec.pick == FIRST || stats.node_cnt >= MIN_NODES))
+        {
+            long long score = 0;
+            if (spec.pick == MOST_NODES)
+                score = stats.node_cnt;
+            else if (spec.pick == MOST_PARTITIONS)
+                for (long long it : stats.partition_cnt)
+                    score += it;
+            if (score > best_score)
+            {
+                best_score = score;
+                best = view;
+            }
+            if (spec.pick == FIRST)
+                break;
+        }
+        if (designer.clickBoard(is_first, solver.getNextSteps()))
+            break;
+        designer.putFlag(solver.getNextFlags());
+        is_first = false;
+    }
+    if (best.empty())
+        return false;
+    fout << "board " << name << '\n'
+         << spec.height << ' ' << spec.width << ' '
+         << spec.mine_number << '\n';
+    for (const auto &row : best)
+        for (int j = 0; j < row.size(); ++j)
+            fout << row[j] << (j + 1 < row.size() ? ' ' : '\n');
+    return true;
+}
+
+void generateCorpus(const string &file_name)
+{
+    ofstream fout(file_name);
+    if (!fout.is_open())
+        printError("Can't Open Corpus File!");
+    fout << "corpus " << CORPUS_VERSION << '\n';
+    for (const auto &spec : SPECS)
+    {
+        unsigned long long seed = spec.seed;
+        for (int k = 1; k <= spec.count; ++k)
+        {
+            string name = spec.name + '-' + std::to_string(k);
+            while (!snapshotGame(spec, seed, name, fout))
+                seed++;
+            std::cout << name << " seed " << seed << std::endl;
+            seed++;
+        }
+    }
+}
+
+// solve N boards of corpus as a batch and one by one
+void runBatch(const vector<Snapshot> &corpus, int n, int thread_num,
+              int iterations)
+{
+    static const unsigned long long SEED = 1;
+    vector<int> height, width, total_mine, cells;
+    vector<long long> offset;
+    for (int i = 0; i < n; ++i)
+    {
+        const Snapshot &s = corpus[i % corpus.size()];
+        height.push_back(s.height);
+        width.push_back(s.width);
+        total_mine.push_back(s.total_mine);
+        offset.push_back(cells.size());
+        cells.insert(cells.end(), s.cells.begin(), s.cells.end());
+    }
+    BoardBatch batch;
+    batch.count = n;
+    batch.height = height.data();
+    batch.width = width.data();
+    batch.total_mine = total_mine.data();
+    batch.offset = offset.data();
+    batch.cells = cells.data();
+
+    // a new Solver for each board, seeded as BatchSolver
+    //  seeds its chunks
+    Timer timer;
+    for (int it = 0; it < iterations; ++it)
+        for (int i = 0; i < n; ++i)
+        {
+            Solver fresh(splitMix64(SEED + i / 16));
+            fresh.readBoard(cells.data() + offset[i], height[i], width[i],
+                            total_mine[i]);
+            fresh.solve();
+        }
+    double fresh_time = timer.elapsed();
+
+    // one by one with a Solver reused
+    Solver single(SEED);
+    timer.reset();
+    for (int it = 0; it < iterations; ++it)
+        for (int i = 0; i < n; ++i)
+        {
+            single.readBoard(cells.data() + offset[i], height[i], width[i],
+                             total_mine[i]);
+            single.solve();
+        }
+    double single_time = timer.elapsed();
+
+    BatchSolver serial(1, SEED), parallel(thread_num, SEED);
+    BatchResult serial_result, result;
+    // warm up scratch memory of the threads
+    parallel.solve(batch, result);
+    timer.reset();
+    for (int it = 0; it < iterations; ++it)
+        serial.solve(batch, serial_result);
+    double serial_time = timer.elapsed();
+    timer.reset();
+    for (int it = 0; it < iterations; ++it)
+        parallel.solve(batch, result);
+    double parallel_time = timer.elapsed();
+
+    bool same = result.step_begin == serial_result.step_begin &&
+                result.steps == serial_result.steps &&
+                result.flag_begin == serial_result.flag_begin &&
+                result.flags == serial_result.flags;
+    long long boards = (long long)n * iterations;
+    std::cout << std::fixed << std::setprecision(0)
+              << "boards: " << n << " x " << iterations << " iterations\n"
+              << "new Solver per board: " << boards / fresh_time << " boards/sec\n"
+              << "one Solver, one by one: " << boards / single_time << " boards/sec\n"
+              << "batch, 1 thread: " << boards / serial_time << " boards/sec\n"
+              << "batch, " << thread_num << " threads: "
+              << boards / parallel_time << " boards/sec\n"
+              << "results of threads "
+              << (same ? "match" : "DIFFER") << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::ios::sync_with_stdio(false);
+    string corpus_file = "bench/corpus_v2.txt";
+    string save_file, compare_file;
+    int iterations = 50;
+    double min_ms = 100;
+    double tolerance = 0.1;
+    int batch_size = 0, thread_num = 1;
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--corpus")
+            corpus_file = argv[++i];
+        else if (arg == "--iterations")
+            iterations = max(1, std::stoi(argv[++i]));
+        else if (arg == "--min-ms")
+            min_ms = max(0.0, std::stod(argv[++i]));
+        else if (arg == "--save")
+            save_file = argv[++i];
+        else if (arg == "--compare")
+            compare_file = argv[++i];
+        else if (arg == "--tolerance")
+            tolerance = max(0.0, std::stod(argv[++i]));
+        else if (arg == "--batch")
+            batch_size = max(1, std::stoi(argv[++i]));
+        else if (arg == "--threads")
+            thread_num = max(1, std::stoi(argv[++i]));
+        else if (arg == "--generate")
+        {
+            generateCorpus(argv[++i]);
+            return 0;
+        }
+    }
+
+    vector<Snapshot> corpus = readCorpus(corpus_file);
+    if (batch_size > 0)
+    {
+        runBatch(corpus, batch_size, thread_num,
+                 max(1, iterations / 10));
+        return 0;
+    }
+    vector<Result> results;
+    std::cout << "corpus " << corpus_file << " (version "
+              << CORPUS_VERSION << "), at least " << iterations
+              << " iterations and " << min_ms << "ms per board\n"
+              << std::left << std::setw(24) << "board"
+              << std::right << std::setw(10) << "size"
+              << std::setw(12) << "median(us)"
+              << std::setw(10) << "p99(us)"
+              << std::setw(10) << "nodes"
+              << std::setw(10) << "pruned"
+              << std::setw(9) << "counted"
+              << std::setw(7) << "parts"
+              << std::setw(7) << "found"
+              << std::setw(8) << "allocs"
+              << std::setw(9) << "scratch" << '\n'
+              << std::fixed << std::setprecision(2);
+    for (const auto &s : corpus)
+    {
+        results.push_back(runSnapshot(s, iterations, min_ms / 1e3));
+        const Result &res = results.back();
+        const SolveStats &stats = res.stats;
+        long long parts = 0, found = 0;
+        for (long long it : stats.partition_cnt)
+            parts += it;
+        for (long long it : stats.found)
+            found += it;
+        string size = std::to_string(s.height) + 'x' + std::to_string(s.width);
+        std::cout << std::left << std::setw(24) << s.name
+                  << std::right << std::setw(10) << size
+                  << std::setw(12) << res.median_ns / 1e3
+                  << std::setw(10) << res.p99_ns / 1e3
+                  << std::setw(10) << stats.node_cnt
+                  << std::setw(10) << stats.prune_cnt
+                  << std::setw(9) << stats.counted_cnt
+                  << std::setw(7) << parts
+                  << std::setw(7) << found
+                  << std::setw(8) << res.allocs
+                  << std::setw(9) << res.scratch_peak / 1024 << std::endl;
+    }
+
+    if (!save_file.empty())
+        saveBaseline(save_file, results);
+    if (!compare_file.empty() &&
+        compareBaseline(compare_file, results, tolerance) > 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,321 @@
+// packed bit planes of board
+#ifndef __BITBOARD_HPP__
+#define __BITBOARD_HPP__
+
+#include "common.h"
+#include "utils.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+typedef unsigned long long Word;
+
+// index of the lowest set bit, w must not be 0
+inline int lowBit(Word w)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#elif defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, w);
+    return idx;
+#else
+    int idx = 0;
+    while (!(w >> idx & 1))
+        idx++;
+    return idx;
+#endif
+}
+
+// # of set bits
+inline int popCount(Word w)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(w);
+#elif defined(_MSC_VER)
+    return (int)__popcnt64(w);
+#else
+    int cnt = 0;
+    for (; w; w &= w - 1)
+        cnt++;
+    return cnt;
+#endif
+}
+
+// one bit plane per status of block
+//  row x is stored in row x+1 and column y in bit y+1,
+//  so the padding around board is always 0
+// 3x3 sums of a whole word (64 blocks) are calculated
+//  at once with shifts and a bit-sliced adder
+class BitBoard
+{
+public:
+    enum Plane
+    {
+        UNKNOWN_BIT,   // unknown blocks
+        FLAG_BIT,      // flags and mines
+        REVEALED_BIT,  // blocks with numbers
+        CANDIDATE_BIT, // unknown blocks next to numbers
+        NUMBER_BIT,    // 4 planes, k th bit of numbers
+        PLANE_NUM = NUMBER_BIT + 4
+    };
+
+private:
+    // special status of board
+    static const int MINE = 16;
+    static const int FLAG = 32;
+    static const int UNKNOWN = 64;
+
+    int height, width;
+    int stride; // # of words per row
+    vector<Word> planes[PLANE_NUM];
+    // scratch planes of findSafe() and findUnsafe()
+    vector<Word> mask, merged;
+
+    inline int wordOf(int x, int y) const
+    {
+        return (x + 1) * stride + ((y + 1) >> 6);
+    }
+
+    inline int bitOf(int y) const
+    {
+        return (y + 1) & 63;
+    }
+
+    inline void setBit(int plane, int x, int y, bool v)
+    {
+        Word b = 1ULL << bitOf(y);
+        Word &w = planes[plane][wordOf(x, y)];
+        w = v ? w | b : w & ~b;
+    }
+
+    // 3 bits of plane centered at column y of padded row r
+    inline int window(const vector<Word> &p, int r, int y) const
+    {
+        int pos = y; // bit of column y-1
+        const Word *row = &p[r * stride];
+        Word w = row[pos >> 6] >> (pos & 63);
+        if ((pos & 63) > 61)
+            w |= row[(pos >> 6) + 1] << (64 - (pos & 63));
+        return w & 7;
+    }
+
+    // word k of padded row r shifted by one column
+    //  so that bit c holds column c-1 (left) or c+1 (right)
+    inline Word shiftLeft(const vector<Word> &p, int r, int k) const
+    {
+        const Word *row = &p[r * stride];
+        return (row[k] << 1) | (k > 0 ? row[k - 1] >> 63 : 0);
+    }
+
+    inline Word shiftRight(const vector<Word> &p, int r, int k) const
+    {
+        const Word *row = &p[r * stride];
+        return (row[k] >> 1) |
+               (k + 1 < stride ? row[k + 1] << 63 : 0);
+    }
+
+    // bit-sliced sum of 3x3 blocks
+    //  c[i] is the i th bit of the sum (0~9)
+    void sum3x3(const vector<Word> &p, int r, int k, Word c[4]) const
+    {
+        c[0] = c[1] = c[2] = c[3] = 0;
+        for (int i = r - 1; i <= r + 1; ++i)
+        {
+            Word a = p[i * stride + k];
+            Word l = shiftLeft(p, i, k);
+            Word h = shiftRight(p, i, k);
+            // horizontal sum in 2 bits
+            Word x0 = a ^ l ^ h;
+            Word x1 = (a & l) | (a & h) | (l & h);
+            // c += x
+            Word k0 = c[0] & x0;
+            c[0] ^= x0;
+            Word k1 = (c[1] & x1) | (c[1] & k0) | (x1 & k0);
+            c[1] ^= x1 ^ k0;
+            Word k2 = c[2] & k1;
+            c[2] ^= k1;
+            c[3] ^= k2;
+        }
+    }
+
+    // any of 3x3 blocks is set
+    Word any3x3(const vector<Word> &p, int r, int k) const
+    {
+        Word w = 0;
+        for (int i = r - 1; i <= r + 1; ++i)
+            w |= p[i * stride + k] |
+                 shiftLeft(p, i, k) | shiftRight(p, i, k);
+        return w;
+    }
+
+    // blocks whose 3x3 sum equals to their numbers
+    Word equalNumber(const Word c[4], int r, int k) const
+    {
+        Word diff = 0;
+        for (int i = 0; i < 4; ++i)
+            diff |= c[i] ^ planes[NUMBER_BIT + i][r * stride + k];
+        return ~diff;
+    }
+
+    // unknown blocks next to blocks in mask
+    void collectNear(vector<Block> &blocks)
+    {
+        for (int r = 1; r <= height; ++r)
+            for (int k = 0; k < stride; ++k)
+            {
+                Word w = planes[UNKNOWN_BIT][r * stride + k] &
+                         any3x3(mask, r, k);
+                for (; w; w &= w - 1)
+                    blocks.emplace_back(make_pair(
+                        r - 1, k * 64 + lowBit(w) - 1));
+            }
+    }
+
+public:
+    // clear board of size height x width
+    void init(int height, int width)
+    {
+        this->height = height;
+        this->width = width;
+        stride = (width + 2 + 63) / 64;
+        for (int i = 0; i < PLANE_NUM; ++i)
+            planes[i].assign((height + 2) * stride, 0);
+        mask.assign((height + 2) * stride, 0);
+        merged.assign((height + 2) * stride, 0);
+    }
+
+    // mark all blocks as unknown, word by word
+    void fillUnknown()
+    {
+        for (int k = 0; k < stride; ++k)
+        {
+            // padded columns 1 ~ width in this word
+            int lo = max(1, k * 64) - k * 64;
+            int hi = min(width, k * 64 + 63) - k * 64;
+            Word m = 0;
+            if (lo <= hi)
+                m = (hi - lo == 63 ? ~0ULL : (1ULL << (hi - lo + 1)) - 1) << lo;
+            for (int r = 1; r <= height; ++r)
+                planes[UNKNOWN_BIT][r * stride + k] = m;
+        }
+    }
+
+    // set type of block, types as in Solver::readBoard()
+    void setBlock(int x, int y, int type)
+    {
+        bool is_number = type <= 8;
+        setBit(UNKNOWN_BIT, x, y, type == UNKNOWN);
+        setBit(FLAG_BIT, x, y, type == MINE || type == FLAG);
+        setBit(REVEALED_BIT, x, y, is_number);
+        for (int i = 0; i < 4; ++i)
+            setBit(NUMBER_BIT + i, x, y, is_number && (type >> i & 1));
+    }
+
+    bool test(int plane, int x, int y) const
+    {
+        return planes[plane][wordOf(x, y)] >> bitOf(y) & 1;
+    }
+
+    // # of blocks in plane among 3x3 blocks centered at (x, y)
+    int countNear(int plane, int x, int y) const
+    {
+        static const int POP[8] = {0, 1, 1, 2, 1, 2, 2, 3};
+        const vector<Word> &p = planes[plane];
+        return POP[window(p, x, y)] +
+               POP[window(p, x + 1, y)] +
+               POP[window(p, x + 2, y)];
+    }
+
+    // candidate = unknown blocks next to revealed blocks
+    void updateCandidate()
+    {
+        for (int r = 1; r <= height; ++r)
+            for (int k = 0; k < stride; ++k)
+                planes[CANDIDATE_BIT][r * stride + k] =
+                    planes[UNKNOWN_BIT][r * stride + k] &
+                    any3x3(planes[REVEALED_BIT], r, k);
+    }
+
+    // call f(x, y) on each block in plane, row-major order
+    template <class F>
+    void forEach(int plane, F f) const
+    {
+        const vector<Word> &p = planes[plane];
+        for (int r = 1; r <= height; ++r)
+            for (int k = 0; k < stride; ++k)
+                for (Word w = p[r * stride + k]; w; w &= w - 1)
+                    f(r - 1, k * 64 + lowBit(w) - 1);
+    }
+
+    // call f(x, y) on blocks in plane in row-major order
+    //  until it returns true, return false if it never does
+    template <class F>
+    bool findFirst(int plane, F f) const
+    {
+        const vector<Word> &p = planes[plane];
+        for (int r = 1; r <= height; ++r)
+            for (int k = 0; k < stride; ++k)
+                for (Word w = p[r * stride + k]; w; w &= w - 1)
+                    if (f(r - 1, k * 64 + lowBit(w) - 1))
+                        return true;
+        return false;
+    }
+
+    // unknown neighbors of numbers whose capacity
+    //  equals to # of mines nearby are safe
+    // append them in row-major order
+    void findSafe(vector<Block> &blocks)
+    {
+        const vector<Word> &flag = planes[FLAG_BIT];
+        const vector<Word> &unknown = planes[UNKNOWN_BIT];
+        for (int r = 1; r <= height; ++r)
+            for (int k = 0; k < stride; ++k)
+            {
+                Word c[4];
+                sum3x3(flag, r, k, c);
+                Word w = planes[REVEALED_BIT][r * stride + k] &
+                         any3x3(unknown, r, k);
+                mask[r * stride + k] = w & equalNumber(c, r, k);
+                if (ALLOW_WARNING)
+                {
+                    // sum > number, compare from the highest bit
+                    Word gt = 0, eq = ~0ULL;
+                    for (int i = 3; i >= 0; --i)
+                    {
+                        Word n = planes[NUMBER_BIT + i][r * stride + k];
+                        gt |= eq & c[i] & ~n;
+                        eq &= ~(c[i] ^ n);
+                    }
+                    for (Word o = w & gt; o; o &= o - 1)
+                        printWarning("detectSafe() Overflow on (" +
+                                     std::to_string(r - 1) + "," +
+                                     std::to_string(k * 64 + lowBit(o) - 1) + ")");
+                }
+            }
+        collectNear(blocks);
+    }
+
+    // unknown neighbors of numbers whose capacity
+    //  equals to # of unknown blocks + mines nearby are mines
+    // append them in row-major order
+    void findUnsafe(vector<Block> &blocks)
+    {
+        for (int i = 0; i < merged.size(); ++i)
+            merged[i] = planes[FLAG_BIT][i] | planes[UNKNOWN_BIT][i];
+        for (int r = 1; r <= height; ++r)
+            for (int k = 0; k < stride; ++k)
+            {
+                Word c[4];
+                sum3x3(merged, r, k, c);
+                mask[r * stride + k] =
+                    planes[REVEALED_BIT][r * stride + k] &
+                    any3x3(planes[UNKNOWN_BIT], r, k) &
+                    equalNumber(c, r, k);
+            }
+        collectNear(blocks);
+    }
+};
+
+#endif
\ No newline at end of file
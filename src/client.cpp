@@ -0,0 +1,244 @@
+#include "common.h"
+#include "utils.hpp"
+#include "designer.hpp"
+#include "autominesweeper.h"
+
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// round-trip latency of the solver server and library
+//  against spawning solver
+// usage: client [games] [--solver PATH] [--server PATH] [--seed S]
+//               [--board W H M]
+//  file: write board.txt, run solver, read steps.txt and flags.txt
+//  library: call ams_solve() of libautominesweeper every move
+//  board: send the whole board to server every move
+//  delta: send changed blocks to server every move
+// games are the same in all modes, POSIX only
+
+// server running in a child process
+struct ServerProcess
+{
+    pid_t pid;
+    FILE *to, *from;
+    char *line = nullptr;
+    size_t cap = 0;
+
+    ServerProcess(const string &path)
+    {
+        int in[2], out[2];
+        if (pipe(in) != 0 || pipe(out) != 0)
+            printError("Can't Create Pipes!");
+        pid = fork();
+        if (pid == 0)
+        {
+            dup2(in[0], 0);
+            dup2(out[1], 1);
+            close(in[1]);
+            close(out[0]);
+            execl(path.c_str(), path.c_str(), (char *)nullptr);
+            _exit(1);
+        }
+        close(in[0]);
+        close(out[1]);
+        to = fdopen(in[1], "w");
+        from = fdopen(out[0], "r");
+    }
+
+    ~ServerProcess()
+    {
+        request("quit");
+        fclose(to);
+        fclose(from);
+        free(line);
+        waitpid(pid, nullptr, 0);
+    }
+
+    // send a request and wait for its reply
+    string request(const string &req)
+    {
+        fputs(req.c_str(), to);
+        fputc('\n', to);
+        fflush(to);
+        if (getline(&line, &cap, from) < 0)
+            printError("Server Closed!");
+        return line;
+    }
+};
+
+// blocks written by solver
+vector<Block> readBlocks(const string &file_name)
+{
+    ifstream fin(file_name);
+    vector<Block> blocks;
+    int x, y;
+    while (fin >> x >> y)
+        blocks.emplace_back(make_pair(x, y));
+    return blocks;
+}
+
+// blocks of "ok S x y ... F x y ..."
+void parseReply(const string &reply,
+                vector<Block> &steps, vector<Block> &flags)
+{
+    std::istringstream sin(reply);
+    string ok;
+    sin >> ok;
+    if (ok != "ok")
+        printError("Server Replied " + reply);
+    for (auto *blocks : {&steps, &flags})
+    {
+        int n;
+        sin >> n;
+        blocks->resize(n);
+        for (auto &it : *blocks)
+            sin >> it.first >> it.second;
+    }
+}
+
+string boardFrame(int game, Designer &designer)
+{
+    string req = "board " + std::to_string(game) + ' ' +
+                 std::to_string(designer.getHeight()) + ' ' +
+                 std::to_string(designer.getWidth()) + ' ' +
+                 std::to_string(designer.getMineNumber());
+    for (const auto &row : designer.getBoard())
+        for (int t : row)
+            req += ' ' + std::to_string(t);
+    return req;
+}
+
+string deltaFrame(int game, const vector<Change> &changes)
+{
+    string req = "delta " + std::to_string(game) + ' ' +
+                 std::to_string(changes.size());
+    for (const auto &it : changes)
+        req += ' ' + std::to_string(it.first.first) + ' ' +
+               std::to_string(it.first.second) + ' ' +
+               std::to_string(it.second);
+    return req;
+}
+
+// play games in mode, return latency of moves
+LatencyHistogram play(const string &mode, long long T,
+                      unsigned long long seed, int width, int height,
+                      int mine_number, const string &solver_path,
+                      const string &server_path)
+{
+    LatencyHistogram latency;
+    std::unique_ptr<ServerProcess> server;
+    if (mode == "board" || mode == "delta")
+        server.reset(new ServerProcess(server_path));
+    ams_solver *lib = mode == "library" ? ams_create(seed) : nullptr;
+    // buffers of library mode
+    vector<int> cells(width * height), out_steps, out_flags;
+    for (long long g = 0; g < T; ++g)
+    {
+        Designer designer(width, height, mine_number, splitMix64(seed + g));
+        designer.initBoard();
+        bool is_first = true;
+        while (!designer.isFinished())
+        {
+            vector<Block> steps, flags;
+            Timer move_timer;
+            if (mode == "file")
+            {
+                designer.printBoard();
+                if (std::system(solver_path.c_str()) != 0)
+                    printError("Can't Run " + solver_path);
+                steps = readBlocks("steps.txt");
+                flags = readBlocks("flags.txt");
+            }
+            else if (mode == "library")
+            {
+                const auto &view = designer.getBoard();
+                for (int i = 0; i < height; ++i)
+                    std::copy(view[i].begin(), view[i].end(),
+                              cells.begin() + i * width);
+                int step_cnt, flag_cnt;
+                while (ams_solve(lib, cells.data(), height, width,
+                                 mine_number, out_steps.data(),
+                                 out_steps.size() / 2, &step_cnt,
+                                 out_flags.data(), out_flags.size() / 2,
+                                 &flag_cnt) == AMS_BUFFER_TOO_SMALL)
+                {
+                    out_steps.resize(2 * max(step_cnt, 1));
+                    out_flags.resize(2 * max(flag_cnt, 1));
+                }
+                for (int i = 0; i < step_cnt; ++i)
+                    steps.emplace_back(out_steps[2 * i], out_steps[2 * i + 1]);
+                for (int i = 0; i < flag_cnt; ++i)
+                    flags.emplace_back(out_flags[2 * i], out_flags[2 * i + 1]);
+            }
+            else if (mode == "board")
+                parseReply(server->request(boardFrame(g, designer)),
+                           steps, flags);
+            else
+            {
+                auto changes = designer.popChanges();
+                string req = is_first
+                                 ? "new " + std::to_string(g) + ' ' +
+                                       std::to_string(height) + ' ' +
+                                       std::to_string(width) + ' ' +
+                                       std::to_string(mine_number)
+                                 : deltaFrame(g, changes);
+                parseReply(server->request(req), steps, flags);
+            }
+            latency.add(move_timer.elapsedNs());
+            if (designer.clickBoard(is_first, steps))
+                break;
+            designer.putFlag(flags);
+            is_first = false;
+        }
+        if (server)
+            server->request("end " + std::to_string(g));
+    }
+    ams_destroy(lib);
+    return latency;
+}
+
+int main(int argc, char *argv[])
+{
+    long long T = 20;
+    string solver_path = "./solver", server_path = "./server";
+    unsigned long long seed = time(0);
+    int width = 30, height = 16, mine_number = 99;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--solver" && i + 1 < argc)
+            solver_path = argv[++i];
+        else if (arg == "--server" && i + 1 < argc)
+            server_path = argv[++i];
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = std::stoull(argv[++i]);
+        else if (arg == "--board" && i + 3 < argc)
+        {
+            width = std::stoi(argv[++i]);
+            height = std::stoi(argv[++i]);
+            mine_number = std::stoi(argv[++i]);
+        }
+        else
+            T = std::stoll(arg);
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "seed: " << seed << '\n';
+    for (string mode : {"file", "library", "board", "delta"})
+    {
+        Timer total_timer;
+        auto latency = play(mode, T, seed, width, height, mine_number,
+                            solver_path, server_path);
+        std::cout << mode << ": " << latency.count() << " moves in "
+                  << total_timer.elapsed() << "s, round trip(us):"
+                  << " mean " << latency.mean() / 1e3
+                  << " p50 " << latency.percentile(0.5) / 1e3
+                  << " p99 " << latency.percentile(0.99) / 1e3
+                  << ", calls/sec " << latency.count() / total_timer.elapsed()
+                  << std::endl;
+    }
+    return 0;
+}
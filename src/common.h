@@ -13,6 +13,7 @@
 #include <ctime>
 #include <iomanip>
 #include <cmath>
+#include <chrono>
 
 using std::ifstream;
 using std::make_pair;
@@ -25,5 +26,7 @@ using std::time;
 using std::vector;
 
 typedef pair<int, int> Block;
+// changed block and its new type
+typedef pair<Block, int> Change;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,538 @@
+// count solutions of a partition without listing them
+#ifndef __COUNTER_HPP__
+#define __COUNTER_HPP__
+
+#include "common.h"
+#include "propagator.hpp"
+
+#include <climits>
+
+// counts of solutions are never negative, but they may not
+//  fit in long long on partitions of a few hundred blocks,
+//  so they are added and multiplied with a check
+// a += b, return false if it overflows
+inline bool addCount(long long &a, long long b)
+{
+#if defined(__GNUC__)
+    return !__builtin_add_overflow(a, b, &a);
+#else
+    if (a > LLONG_MAX - b)
+        return false;
+    a += b;
+    return true;
+#endif
+}
+
+// a += b * c, return false if it overflows
+inline bool addProduct(long long &a, long long b, long long c)
+{
+#if defined(__GNUC__)
+    long long p;
+    return !__builtin_mul_overflow(b, c, &p) && addCount(a, p);
+#else
+    if (c != 0 && b > LLONG_MAX / c)
+        return false;
+    return addCount(a, b * c);
+#endif
+}
+
+// product c of two polynomials a and b of a_len and b_len terms
+//  a[k] is the coefficient of x^k, x^k means k mines
+// return false if a coefficient overflows
+inline bool multiplyPoly(const long long *a, int a_len,
+                         const long long *b, int b_len,
+                         vector<long long> &c)
+{
+    c.assign(a_len + b_len - 1, 0);
+    bool ok = true;
+    for (int i = 0; i < a_len; ++i)
+        if (a[i] != 0)
+            for (int j = 0; j < b_len; ++j)
+                ok = addProduct(c[i + j], a[i], b[j]) && ok;
+    return ok;
+}
+
+inline bool multiplyPoly(const vector<long long> &a,
+                         const vector<long long> &b,
+                         vector<long long> &c)
+{
+    return multiplyPoly(a.data(), a.size(), b.data(), b.size(), c);
+}
+
+// hash of n ints from p
+inline size_t hashInts(const int *p, int n)
+{
+    unsigned long long h = 1469598103934665603ULL;
+    for (int i = 0; i < n; ++i)
+        h = (h ^ (unsigned)p[i]) * 1099511628211ULL;
+    return h;
+}
+
+// hash of a vector of int
+struct VectorHash
+{
+    size_t operator()(const vector<int> &v) const
+    {
+        return hashInts(v.data(), v.size());
+    }
+};
+
+// count solutions by splitting constraints into components
+//  after some variables are assigned, the remaining variables
+//  often fall into groups sharing no constraint,
+//  and their solutions are counted separately and multiplied
+// counts of a component only depend on its variables and
+//  mines still needed by its constraints, so they are cached
+// results are the same as Propagator::count(), unless some
+//  count does not fit in long long, then counting stops and
+//  it fails, see isOverflow()
+class ComponentCounter : public Propagator
+{
+private:
+    // variables of a component, read like a const vector
+    typedef FlatLists::List Span;
+
+    // solutions of a group of variables
+    //  cnt[k]: # of solutions with k mines
+    //  block_cnt[i * (n + 1) + k]: # of solutions with k mines
+    //   and vars[i] is a mine, n = vars.size()
+    // buffers keep their capacity when a Result is reused
+    struct Result
+    {
+        vector<int> vars; // sorted
+        vector<long long> cnt;
+        vector<long long> block_cnt;
+
+        void reset(Span comp)
+        {
+            int n = comp.size();
+            vars.assign(comp.begin(), comp.end());
+            cnt.assign(n + 1, 0);
+            block_cnt.assign(n * (n + 1), 0);
+        }
+    };
+
+    // scratch of countRest() at one depth of the search and of
+    //  countComponent() called by it, nodes at the same depth
+    //  never overlap, so they share it and after the first
+    //  partitions counting takes nothing from heap
+    struct Frame
+    {
+        // components of split(), comp i is
+        //  items[start[i]] ~ items[start[i + 1] - 1]
+        vector<int> items, start;
+        vector<Result> subs;
+        // prefix[i] = product of first i components
+        //  suffix[i] = product of components from i
+        vector<vector<long long>> prefix, suffix;
+        vector<long long> others, cur;
+        vector<int> key, cons; // of makeKey()
+    };
+    vector<Frame> frames; // frames[d] at depth d
+    Result top;           // result of count()
+    vector<int> all_vars;
+
+    // at most this many results are cached
+    // entry e has key key_pool[key_start[e]] ~ key_pool[key_start[e + 1] - 1]
+    //  and counts from cnt_pool[cnt_start[e]], cnt then block_cnt
+    // slots are open addressing over entries, a slot is empty
+    //  unless its stamp is cache_stamp, so clearing is O(1)
+    static const int CACHE_LIMIT = 1 << 16;
+    struct Slot
+    {
+        int entry;
+        unsigned stamp;
+    };
+    vector<int> key_pool, key_start;
+    vector<long long> cnt_pool;
+    vector<size_t> cnt_start, entry_hash;
+    vector<Slot> slots;
+    unsigned cache_stamp = 0;
+
+    // stamps to mark visited variables and constraints
+    vector<int> var_stamp, con_stamp;
+    int stamp;
+
+    // scratch of chooseVar(), indexed by position in comp
+    //  except local, which maps variables to positions
+    vector<int> local, adj_begin, adj;
+    vector<int> disc, low, sub, largest, separated, pos, path;
+
+    // some count of last count() does not fit in long long
+    bool overflow;
+
+    // c = a * b, or overflow
+    void multiply(const vector<long long> &a, const vector<long long> &b,
+                  vector<long long> &c)
+    {
+        if (!multiplyPoly(a, b, c))
+            overflow = true;
+    }
+
+    // a += b, or overflow
+    void add(long long &a, long long b)
+    {
+        if (!addCount(a, b))
+            overflow = true;
+    }
+
+    Span comp(const Frame &f, int i) const
+    {
+        const int *p = f.items.data();
+        return Span{p + f.start[i], p + f.start[i + 1]};
+    }
+
+    void clearCache()
+    {
+        key_pool.clear();
+        key_start.assign(1, 0);
+        cnt_pool.clear();
+        cnt_start.clear();
+        entry_hash.clear();
+        if (slots.empty())
+            slots.assign(1024, Slot{0, 0});
+        cache_stamp++;
+    }
+
+    // slot of key, or the empty slot it would take
+    Slot &findSlot(const vector<int> &key, size_t hash)
+    {
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            Slot &slot = slots[i];
+            if (slot.stamp != cache_stamp)
+                return slot;
+            int e = slot.entry;
+            if (entry_hash[e] == hash &&
+                key_start[e + 1] - key_start[e] == key.size() &&
+                std::equal(key.begin(), key.end(),
+                           key_pool.begin() + key_start[e]))
+                return slot;
+        }
+    }
+
+    // copy cached result of key to res
+    //  return false if not found
+    bool findCached(const vector<int> &key, Span comp, Result &res)
+    {
+        const Slot &slot = findSlot(key, hashInts(key.data(), key.size()));
+        if (slot.stamp != cache_stamp)
+            return false;
+        int n = comp.size();
+        const long long *p = cnt_pool.data() + cnt_start[slot.entry];
+        res.vars.assign(comp.begin(), comp.end());
+        res.cnt.assign(p, p + n + 1);
+        res.block_cnt.assign(p + n + 1, p + (n + 1) * (n + 1));
+        return true;
+    }
+
+    void insertCached(const vector<int> &key, const Result &res)
+    {
+        if (cnt_start.size() >= CACHE_LIMIT)
+            return;
+        // at most half of slots are used
+        if (2 * (cnt_start.size() + 1) > slots.size())
+        {
+            slots.assign(2 * slots.size(), Slot{0, 0});
+            cache_stamp++;
+            for (int e = 0; e < cnt_start.size(); ++e)
+            {
+                size_t mask = slots.size() - 1;
+                size_t i = entry_hash[e] & mask;
+                while (slots[i].stamp == cache_stamp)
+                    i = (i + 1) & mask;
+                slots[i] = Slot{e, cache_stamp};
+            }
+        }
+        size_t hash = hashInts(key.data(), key.size());
+        Slot &slot = findSlot(key, hash);
+        slot = Slot{(int)cnt_start.size(), cache_stamp};
+        key_pool.insert(key_pool.end(), key.begin(), key.end());
+        key_start.push_back(key_pool.size());
+        cnt_start.push_back(cnt_pool.size());
+        entry_hash.push_back(hash);
+        cnt_pool.insert(cnt_pool.end(), res.cnt.begin(), res.cnt.end());
+        cnt_pool.insert(cnt_pool.end(), res.block_cnt.begin(), res.block_cnt.end());
+    }
+
+    // split unassigned variables of vars into components
+    //  connected by constraints, into items and start of f
+    void split(Span vars, Frame &f)
+    {
+        f.items.clear();
+        f.start.assign(1, 0);
+        stamp++;
+        for (int s : vars)
+        {
+            if (value[s] >= 0 || var_stamp[s] == stamp)
+                continue;
+            int first = f.items.size();
+            f.items.push_back(s);
+            var_stamp[s] = stamp;
+            for (int i = first; i < f.items.size(); ++i)
+                for (int c : consOf(f.items[i]))
+                    if (con_stamp[c] != stamp)
+                    {
+                        con_stamp[c] = stamp;
+                        for (int u : cons->vars[c])
+                            if (value[u] < 0 && var_stamp[u] != stamp)
+                            {
+                                var_stamp[u] = stamp;
+                                f.items.push_back(u);
+                            }
+                    }
+            std::sort(f.items.begin() + first, f.items.end());
+            f.start.push_back(f.items.size());
+        }
+    }
+
+    // variables of comp, then mines still needed
+    //  by each constraint touching comp, into key of f
+    void makeKey(Span comp, Frame &f)
+    {
+        auto &cs = f.cons;
+        cs.clear();
+        for (int v : comp)
+            for (int c : consOf(v))
+                cs.push_back(c);
+        std::sort(cs.begin(), cs.end());
+        cs.resize(std::unique(cs.begin(), cs.end()) - cs.begin());
+        f.key.assign(comp.begin(), comp.end());
+        f.key.push_back(-1);
+        for (int c : cs)
+        {
+            f.key.push_back(c);
+            f.key.push_back(need[c]);
+        }
+    }
+
+    // choose the variable leaving the smallest largest component
+    //  once it is assigned, ties go to the one with most constraints
+    // variables are linked if they share a constraint, removing
+    //  an articulation point of this graph splits comp, and
+    //  each side is counted on its own in countRest()
+    // articulation points and the sizes of the pieces are found
+    //  by an iterative Tarjan search in O(links)
+    int chooseVar(Span comp)
+    {
+        int n = comp.size();
+        for (int i = 0; i < n; ++i)
+            local[comp[i]] = i;
+        adj_begin.resize(n + 1);
+        adj.clear();
+        for (int i = 0; i < n; ++i)
+        {
+            adj_begin[i] = adj.size();
+            for (int c : consOf(comp[i]))
+                for (int u : cons->vars[c])
+                    if (value[u] < 0 && u != comp[i])
+                        adj.push_back(local[u]);
+        }
+        adj_begin[n] = adj.size();
+
+        // sub: size of subtree, separated: total size of child
+        //  subtrees cut off by removing the node, largest: the
+        //  largest of them
+        disc.assign(n, -1);
+        low.assign(n, 0);
+        sub.assign(n, 1);
+        largest.assign(n, 0);
+        separated.assign(n, 0);
+        pos.resize(n);
+        int time = 0;
+        disc[0] = low[0] = time++;
+        pos[0] = adj_begin[0];
+        path.assign(1, 0);
+        while (!path.empty())
+        {
+            int u = path.back();
+            if (pos[u] < adj_begin[u + 1])
+            {
+                int w = adj[pos[u]++];
+                if (disc[w] < 0)
+                {
+                    disc[w] = low[w] = time++;
+                    pos[w] = adj_begin[w];
+                    path.push_back(w);
+                }
+                else
+                    low[u] = min(low[u], disc[w]);
+                continue;
+            }
+            path.pop_back();
+            if (path.empty())
+                break;
+            int p = path.back();
+            low[p] = min(low[p], low[u]);
+            sub[p] += sub[u];
+            // the root cuts off all its children
+            if (low[u] >= disc[p])
+            {
+                largest[p] = max(largest[p], sub[u]);
+                separated[p] += sub[u];
+            }
+        }
+
+        int best = 0, best_piece = n;
+        for (int i = 0; i < n; ++i)
+        {
+            int piece = max(largest[i], n - 1 - separated[i]);
+            if (piece < best_piece ||
+                (piece == best_piece &&
+                 consOf(comp[i]).size() > consOf(comp[best]).size()))
+            {
+                best = i;
+                best_piece = piece;
+            }
+        }
+        return comp[best];
+    }
+
+    // solutions of vars, where trail[mark..] are assigned
+    //  in this branch and the others are unassigned
+    // d is the depth of this node, see Frame
+    void countRest(Span vars, int mark, Result &res, int d)
+    {
+        Frame &f = frames[d];
+        int fixed_mine = 0;
+        for (int i = mark; i < trail.size(); ++i)
+            fixed_mine += value[trail[i]];
+        split(vars, f);
+        int n = f.start.size() - 1;
+        if (f.subs.size() < n)
+            f.subs.resize(n);
+        for (int i = 0; i < n; ++i)
+            countComponent(comp(f, i), f.subs[i], d);
+        // results are incomplete
+        if (stopped() || overflow)
+            return;
+        // a component without solutions leaves none, and
+        //  products of the others might overflow for nothing
+        for (int i = 0; i < n; ++i)
+            if (std::all_of(f.subs[i].cnt.begin(), f.subs[i].cnt.end(), [](long long c)
+                            { return c == 0; }))
+                return;
+
+        if (f.prefix.size() < n + 1)
+        {
+            f.prefix.resize(n + 1);
+            f.suffix.resize(n + 1);
+        }
+        f.prefix[0].assign(1, 1);
+        f.suffix[n].assign(1, 1);
+        for (int i = 0; i < n; ++i)
+            multiply(f.prefix[i], f.subs[i].cnt, f.prefix[i + 1]);
+        for (int i = n - 1; i >= 0; --i)
+            multiply(f.subs[i].cnt, f.suffix[i + 1], f.suffix[i]);
+
+        int stride = vars.size() + 1;
+        const auto &total = f.prefix[n];
+        for (int k = 0; k < total.size(); ++k)
+            add(res.cnt[k + fixed_mine], total[k]);
+        // variables fixed to mines in this branch
+        for (int i = mark; i < trail.size(); ++i)
+            if (value[trail[i]] == 1)
+            {
+                int p = std::lower_bound(vars.begin(), vars.end(), trail[i]) -
+                        vars.begin();
+                for (int k = 0; k < total.size(); ++k)
+                    add(res.block_cnt[p * stride + k + fixed_mine], total[k]);
+            }
+        for (int i = 0; i < n; ++i)
+        {
+            multiply(f.prefix[i], f.suffix[i + 1], f.others);
+            const Result &sub = f.subs[i];
+            int m = sub.vars.size();
+            for (int j = 0; j < m; ++j)
+            {
+                int p = std::lower_bound(vars.begin(), vars.end(), sub.vars[j]) -
+                        vars.begin();
+                if (!multiplyPoly(sub.block_cnt.data() + j * (m + 1), m + 1,
+                                  f.others.data(), f.others.size(), f.cur))
+                    overflow = true;
+                for (int k = 0; k < f.cur.size(); ++k)
+                    add(res.block_cnt[p * stride + k + fixed_mine], f.cur[k]);
+            }
+        }
+    }
+
+    // solutions of a component of unassigned variables
+    //  called by countRest() at depth d
+    void countComponent(Span comp, Result &res, int d)
+    {
+        if (stopped() || overflow)
+            return;
+        Frame &f = frames[d];
+        makeKey(comp, f);
+        if (findCached(f.key, comp, res))
+            return;
+
+        node_cnt++;
+        res.reset(comp);
+        int v = chooseVar(comp);
+        // try mine first, then safe
+        for (int val = 1; val >= 0; --val)
+        {
+            int mark = trail.size();
+            if (assign(v, val) && propagate())
+                countRest(comp, mark, res, d + 1);
+            else
+                prune_cnt++;
+            pending.clear();
+            undo(mark);
+        }
+
+        // countRest() at depth d + 1 leaves the key of f alone
+        if (!stopped() && !overflow)
+            insertCached(f.key, res);
+    }
+
+public:
+    // count solutions of constraints
+    //  the same as Propagator::count()
+    // return false if it is stopped or overflows
+    bool count(const Constraints &cons,
+               vector<long long> &cnt,
+               vector<long long> &block_cnt)
+    {
+        int n = cons.var_num;
+        clearCache();
+        var_stamp.assign(n, 0);
+        local.assign(n, -1);
+        con_stamp.assign(cons.vars.size(), 0);
+        stamp = 0;
+        overflow = false;
+        // each level assigns a variable
+        if (frames.size() < n + 2)
+            frames.resize(n + 2);
+
+        top.cnt.assign(n + 1, 0);
+        top.block_cnt.assign(n * (n + 1), 0);
+        if (init(cons))
+        {
+            all_vars.resize(n);
+            for (int i = 0; i < n; ++i)
+                all_vars[i] = i;
+            const int *p = all_vars.data();
+            countRest(Span{p, p + n}, 0, top, 0);
+        }
+        pending.clear();
+        undo(0);
+        // sums of counts over # of mines must fit as well
+        long long total = 0;
+        for (long long it : top.cnt)
+            add(total, it);
+        cnt.assign(top.cnt.begin(), top.cnt.end());
+        block_cnt.assign(top.block_cnt.begin(), top.block_cnt.end());
+        return finished() && !overflow;
+    }
+
+    // whether last count() failed as a count overflows
+    bool isOverflow() const
+    {
+        return overflow;
+    }
+};
+
+#endif
\ No newline at end of file
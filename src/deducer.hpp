@@ -0,0 +1,278 @@
+// find certain blocks of a partition without search
+#ifndef __DEDUCER_HPP__
+#define __DEDUCER_HPP__
+
+#include "common.h"
+#include "propagator.hpp"
+
+#include <cstdlib>
+
+// variables taking the same value in all solutions, found
+//  from constraints alone, which settles 1-2-1 and other
+//  patterns of a few numbers much faster than counting
+// only constraints without outside unknowns are equations,
+//  the others only bound their variables and are left out
+// rules are repeated while they fix new variables:
+// (1) an equation needing 0 mines or all its variables
+// (2) subset: if the variables of a are among those of b,
+//  the others of b hold need[b] - need[a] mines
+// (3) gaussian elimination over the equations, a reduced
+//  row whose right side is the smallest (or largest) value
+//  of its left side fixes all its variables
+// elimination is exact, rows stay integers and are divided
+//  by their gcd, it gives up if an entry grows too large
+// equations and the matrix are flat buffers kept across
+//  calls, so deducing allocates nothing once they are large
+//  enough
+class Deducer
+{
+private:
+    // variables of equation e, sorted and unfixed only, are
+    //  eq_vars[eq_begin[e]] ~ eq_vars[eq_end[e] - 1]
+    //  substitute() moves eq_end[e] down
+    vector<int> eq_vars, eq_begin, eq_end, eq_need;
+    int eq_num;
+    // equations of variable v are
+    //  var_eqs[var_begin[v]] ~ var_eqs[var_begin[v + 1] - 1]
+    vector<int> var_begin, var_eqs;
+    vector<int> *value;
+    int fixed_cnt;
+
+    // matrix of elimination, row r is rows[r * width] ~
+    //  rows[r * width + width - 1], the last column is
+    //  the right side
+    vector<long long> rows;
+    int row_num, width;
+    vector<int> col_var; // variable of each column
+    vector<int> var_col; // column of each variable, -1 if fixed
+
+    // partitions larger than this are not eliminated
+    static const int ELIMINATE_MAX_VARS = 128;
+    // entries beyond this may overflow in the next step
+    static const long long ENTRY_LIMIT = 1LL << 30;
+
+    void fix(int v, int x)
+    {
+        if ((*value)[v] < 0)
+        {
+            (*value)[v] = x;
+            fixed_cnt++;
+        }
+    }
+
+    // drop fixed variables from equations
+    void substitute()
+    {
+        for (int e = 0; e < eq_num; ++e)
+        {
+            int k = eq_begin[e];
+            for (int i = eq_begin[e]; i < eq_end[e]; ++i)
+            {
+                int v = eq_vars[i];
+                if ((*value)[v] < 0)
+                    eq_vars[k++] = v;
+                else
+                    eq_need[e] -= (*value)[v];
+            }
+            eq_end[e] = k;
+        }
+    }
+
+    // rules (1) and (2)
+    void applySubsets()
+    {
+        for (int e = 0; e < eq_num; ++e)
+        {
+            int size = eq_end[e] - eq_begin[e];
+            if (size > 0 && (eq_need[e] == 0 || eq_need[e] == size))
+                for (int i = eq_begin[e]; i < eq_end[e]; ++i)
+                    fix(eq_vars[i], eq_need[e] > 0);
+        }
+        for (int a = 0; a < eq_num; ++a)
+        {
+            const int *small = &eq_vars[0] + eq_begin[a];
+            const int *small_end = &eq_vars[0] + eq_end[a];
+            if (small == small_end)
+                continue;
+            // b contains all variables of a, so it contains the first
+            int first = *small;
+            for (int i = var_begin[first]; i < var_begin[first + 1]; ++i)
+            {
+                int b = var_eqs[i];
+                const int *large = &eq_vars[0] + eq_begin[b];
+                const int *large_end = &eq_vars[0] + eq_end[b];
+                if (b == a || large_end - large <= small_end - small ||
+                    !std::includes(large, large_end, small, small_end))
+                    continue;
+                int rest = eq_need[b] - eq_need[a];
+                int rest_cnt = (large_end - large) - (small_end - small);
+                if (rest != 0 && rest != rest_cnt)
+                    continue;
+                for (const int *v = large; v != large_end; ++v)
+                    if (!std::binary_search(small, small_end, *v))
+                        fix(*v, rest > 0);
+            }
+        }
+    }
+
+    static long long gcd(long long a, long long b)
+    {
+        while (b != 0)
+        {
+            a %= b;
+            std::swap(a, b);
+        }
+        return a;
+    }
+
+    long long *row(int r)
+    {
+        return &rows[r * width];
+    }
+
+    // divide row r by the gcd of its entries
+    //  return false if an entry is too large
+    bool reduceRow(int r)
+    {
+        long long *p = row(r);
+        long long g = 0;
+        for (int k = 0; k < width; ++k)
+        {
+            if (std::llabs(p[k]) > ENTRY_LIMIT)
+                return false;
+            // most rows reach 1 at once
+            if (g != 1)
+                g = gcd(g, std::llabs(p[k]));
+        }
+        if (g > 1)
+            for (int k = 0; k < width; ++k)
+                p[k] /= g;
+        return true;
+    }
+
+    // rule (3)
+    void eliminate()
+    {
+        col_var.clear();
+        for (int v = 0; v < value->size(); ++v)
+        {
+            var_col[v] = -1;
+            if ((*value)[v] < 0)
+            {
+                var_col[v] = col_var.size();
+                col_var.push_back(v);
+            }
+        }
+        int n = col_var.size();
+        if (n == 0 || n > ELIMINATE_MAX_VARS)
+            return;
+        width = n + 1;
+        row_num = 0;
+        for (int e = 0; e < eq_num; ++e)
+            if (eq_end[e] > eq_begin[e])
+                row_num++;
+        rows.assign(row_num * width, 0);
+        for (int e = 0, r = 0; e < eq_num; ++e)
+            if (eq_end[e] > eq_begin[e])
+            {
+                for (int i = eq_begin[e]; i < eq_end[e]; ++i)
+                    row(r)[var_col[eq_vars[i]]] = 1;
+                row(r)[n] = eq_need[e];
+                r++;
+            }
+
+        int rank = 0;
+        for (int c = 0; c < n && rank < row_num; ++c)
+        {
+            int pivot = rank;
+            while (pivot < row_num && row(pivot)[c] == 0)
+                pivot++;
+            if (pivot == row_num)
+                continue;
+            std::swap_ranges(row(rank), row(rank) + width, row(pivot));
+            const long long *p = row(rank);
+            for (int r = 0; r < row_num; ++r)
+            {
+                long long *q = row(r);
+                if (r == rank || q[c] == 0)
+                    continue;
+                long long f = q[c];
+                for (int k = 0; k <= n; ++k)
+                    q[k] = q[k] * p[c] - p[k] * f;
+                if (!reduceRow(r))
+                    return;
+            }
+            rank++;
+        }
+
+        for (int r = 0; r < row_num; ++r)
+        {
+            const long long *q = row(r);
+            long long lo = 0, hi = 0;
+            for (int k = 0; k < n; ++k)
+                (q[k] < 0 ? lo : hi) += q[k];
+            if (lo == hi || (q[n] != lo && q[n] != hi))
+                continue;
+            // right side is hi: positive entries are mines,
+            //  negative ones are safe, and the other way round
+            bool at_hi = q[n] == hi;
+            for (int k = 0; k < n; ++k)
+                if (q[k] != 0)
+                    fix(col_var[k], (q[k] > 0) == at_hi);
+        }
+    }
+
+public:
+    // fix variables of cons which are certain, value[v] is
+    //  1 for a mine, 0 for safe and -1 if it is not certain
+    // return # of variables fixed
+    int deduce(const Constraints &cons, vector<int> &value)
+    {
+        this->value = &value;
+        value.assign(cons.var_num, -1);
+        fixed_cnt = 0;
+        int n = cons.var_num;
+        eq_vars.clear();
+        eq_begin.clear();
+        eq_end.clear();
+        eq_need.clear();
+        var_begin.assign(n + 1, 0);
+        for (int i = 0; i < cons.vars.size(); ++i)
+            if (cons.outside[i] == 0 && !cons.vars[i].empty())
+            {
+                eq_begin.push_back(eq_vars.size());
+                eq_vars.insert(eq_vars.end(), cons.vars[i].begin(), cons.vars[i].end());
+                eq_end.push_back(eq_vars.size());
+                eq_need.push_back(cons.need[i]);
+                std::sort(eq_vars.begin() + eq_begin.back(), eq_vars.end());
+                for (int v : cons.vars[i])
+                    var_begin[v]++;
+            }
+        eq_num = eq_need.size();
+        // var_begin[v] is the end of the range of v, then
+        //  moves to its beginning as the range is filled
+        for (int v = 1; v <= n; ++v)
+            var_begin[v] += var_begin[v - 1];
+        var_eqs.resize(var_begin[n]);
+        for (int e = eq_num - 1; e >= 0; --e)
+            for (int i = eq_begin[e]; i < eq_end[e]; ++i)
+                var_eqs[--var_begin[eq_vars[i]]] = e;
+        var_col.resize(n);
+
+        int last = -1;
+        while (fixed_cnt > last)
+        {
+            last = fixed_cnt;
+            applySubsets();
+            substitute();
+            if (fixed_cnt == last)
+            {
+                eliminate();
+                substitute();
+            }
+        }
+        return fixed_cnt;
+    }
+};
+
+#endif
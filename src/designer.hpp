@@ -0,0 +1,268 @@
+// interactive minesweeper for testing
+#ifndef __DESIGNER_HPP__
+#define __DESIGNER_HPP__
+
+#include "common.h"
+#include "utils.hpp"
+
+class Designer
+{
+private:
+    // special status of board
+    static const int MINE = 16;
+    static const int FLAG = 32;
+    static const int UNKNOWN = 64;
+
+    int mine_number;
+    int width, height;
+    int visible_cnt; // # of visited blocks
+    vector<vector<int>> board;
+    vector<vector<bool>> vis;
+    // what the player sees, same format as board.txt
+    vector<vector<int>> view;
+    // generator of mines
+    std::mt19937 gen;
+    // blocks of view changed since last popChanges()
+    vector<Change> changes;
+    // mines of this game, set at first click
+    //  or by loadMines() before it
+    vector<Block> mines;
+    bool mines_loaded = false;
+
+    // generate mines
+    //  excluding first click
+    void genMines(Block first_click)
+    {
+        // generate mines
+        if (!mines_loaded)
+        {
+            mines.clear();
+            for (int i = 0; i < height; ++i)
+                for (int j = 0; j < width; ++j)
+                    if (i != first_click.first &&
+                        j != first_click.second)
+                        mines.emplace_back(make_pair(i, j));
+            std::shuffle(mines.begin(), mines.end(), gen);
+            mines.resize(mine_number);
+        }
+        for (const auto &mine : mines)
+            board[mine.first][mine.second] = MINE;
+        // update board
+        for (int i = 0; i < height; ++i)
+            for (int j = 0; j < width; ++j)
+                if (board[i][j] == 0)
+                {
+                    int cnt = 0;
+                    for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
+                        for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
+                            cnt += board[x][y] == MINE;
+                    board[i][j] = cnt;
+                }
+    }
+
+    // mark block as visited
+    //  and show it to the player
+    void visit(int x, int y)
+    {
+        vis[x][y] = true;
+        view[x][y] = board[x][y];
+        visible_cnt++;
+        changes.emplace_back(make_pair(x, y), view[x][y]);
+    }
+
+    // visit all neighbors of '0'
+    //  with an explicit stack, openings of large boards
+    //  are too deep for recursion
+    void dfsVisit(Block start)
+    {
+        vector<Block> stack(1, start);
+        while (!stack.empty())
+        {
+            int x = stack.back().first, y = stack.back().second;
+            stack.pop_back();
+            for (int i = max(x - 1, 0); i <= min(x + 1, height - 1); ++i)
+                for (int j = max(y - 1, 0); j <= min(y + 1, width - 1); ++j)
+                    if (!vis[i][j])
+                    {
+                        visit(i, j);
+                        if (board[i][j] == 0)
+                            stack.emplace_back(make_pair(i, j));
+                    }
+        }
+    }
+
+    // read points from file
+    vector<Block> readPoints(string file_name)
+    {
+        ifstream fin(file_name);
+        if (!fin.is_open())
+            printError("File Not Found!");
+
+        vector<Block> points;
+        int x, y;
+        while (fin >> x >> y)
+            points.emplace_back(make_pair(x, y));
+        return points;
+    }
+
+public:
+    Designer(int width = 30, int height = 16,
+             int mine_number = 99,
+             unsigned long long seed = time(0))
+    {
+        this->width = width;
+        this->height = height;
+        this->mine_number = mine_number;
+        setSeed(seed);
+    }
+
+    // reset generator of mines
+    void setSeed(unsigned long long seed)
+    {
+        seedGenerator(gen, seed);
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getMineNumber() const { return mine_number; }
+
+    // clear and initialize board
+    void initBoard()
+    {
+        // clear
+        vis.clear();
+        vis = vector<vector<bool>>(height,
+                                   vector<bool>(width, 0));
+        board.clear();
+        board = vector<vector<int>>(height,
+                                    vector<int>(width, 0));
+        view = vector<vector<int>>(height,
+                                   vector<int>(width, (int)UNKNOWN));
+        visible_cnt = 0;
+        changes.clear();
+        mines.clear();
+        mines_loaded = false;
+    }
+
+    // place these mines at first click instead of generating
+    //  them, to replay a recorded game
+    //  call it after initBoard()
+    void loadMines(const vector<Block> &mines)
+    {
+        this->mines = mines;
+        mines_loaded = true;
+    }
+
+    // mines of this game, empty before first click
+    const vector<Block> &getMines() const
+    {
+        return mines;
+    }
+
+    // board seen by the player
+    //  it can be passed to Solver::readBoard() directly
+    const vector<vector<int>> &getBoard() const
+    {
+        return view;
+    }
+
+    // return blocks of view changed since last call
+    //  they can be passed to Solver::updateBoard()
+    vector<Change> popChanges()
+    {
+        vector<Change> ret;
+        ret.swap(changes);
+        return ret;
+    }
+
+    // print board
+    void printBoard(string file_name = "board.txt")
+    {
+        ofstream fout(file_name);
+        if (!fout.is_open())
+            printError("Can't Open Output File!");
+        fout << height << ' ' << width << ' '
+             << mine_number << std::endl;
+        for (int i = 0; i < height; ++i)
+        {
+            for (int j = 0; j < width; ++j)
+            {
+                fout.width(3);
+                fout << view[i][j] << ' ';
+            }
+            fout << std::endl;
+        }
+        fout.close();
+    }
+
+    // click points
+    //  return true if encounter mines
+    // moreover, if it is the first click,
+    //  then generate mines.
+    bool clickBoard(bool is_first,
+                    const vector<Block> &points)
+    {
+        if (points.empty())
+        {
+            printWarning("No Next Step!");
+            return false;
+        }
+
+        if (is_first)
+            genMines(points.front());
+        for (const auto &it : points)
+            if (!vis[it.first][it.second])
+            {
+                visit(it.first, it.second);
+                if (board[it.first][it.second] == 0)
+                    dfsVisit(it);
+                if (board[it.first][it.second] == MINE)
+                    return true;
+            }
+            else // warning may be caused by dfsVisit
+                printWarning("Click Existing Block(" +
+                             std::to_string(it.first) + "," +
+                             std::to_string(it.second) + ")");
+        return false;
+    }
+
+    // click points read from file
+    bool clickBoard(bool is_first,
+                    string file_name = "steps.txt")
+    {
+        return clickBoard(is_first, readPoints(file_name));
+    }
+
+    // put flags
+    void putFlag(const vector<Block> &points)
+    {
+        if (points.empty())
+            printWarning("No Next Flag!");
+
+        for (const auto &it : points)
+            if (!vis[it.first][it.second])
+            {
+                board[it.first][it.second] =
+                    view[it.first][it.second] = FLAG;
+                changes.emplace_back(it, view[it.first][it.second]);
+            }
+            else
+                printWarning("Put Flag on Existing Block(" +
+                             std::to_string(it.first) + "," +
+                             std::to_string(it.second) + ")");
+    }
+
+    // put flags read from file
+    void putFlag(string file_name = "flags.txt")
+    {
+        putFlag(readPoints(file_name));
+    }
+
+    // return true if all mines are found
+    bool isFinished()
+    {
+        return visible_cnt == height * width - mine_number;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -1,206 +1,551 @@
 #include "common.h"
+#include "designer.hpp"
 #include "solver.hpp"
+#include "replay_log.hpp"
+#include "alloc_counter.hpp"
 
-class Designer
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// self-play benchmark
+// usage: main [games] [--file | --incremental] [--threads N] [--seed S]
+//             [--board W H M] [--verify] [--solver-threads N]
+//             [--cache-mb N] [--budget-ms X]
+//             [--sample-ms X] [--sample-above N] [--metrics FILE]
+//             [--replay FILE] [--lookahead-ms X] [--lookahead-depth D]
+//             [--paired]
+//  --file: exchange board/steps/flags through text files
+//   (the protocol used by the python frontend)
+//  --incremental: only pass changed blocks to a long-lived Solver
+//  otherwise Designer and Solver talk in memory
+//  --threads: # of workers, default to # of cores
+//  --seed: base seed, game i is seeded with splitMix64(seed + i)
+//   so results do not depend on # of workers
+//  --board: width, height and # of mines, default to 30 16 99
+//  --verify: compare counts of partitions with listing solutions
+//  --solver-threads: # of threads counting partitions in each Solver
+//   default to 1, use with --threads 1 to avoid oversubscription
+//  --cache-mb: memory limit of cached partition counts
+//   of each Solver in MB, 0 to disable, default to 16
+//  --budget-ms: time budget of each move in ms, 0 for no limit
+//   moves out of time are guessed with rough estimates
+//  --sample-ms: sample partitions not counted in time
+//   for at most X ms per move instead of rough estimates
+//  --sample-above: sample partitions with more than N blocks
+//   without counting them
+//  --metrics: write statistics of each move and each game
+//   to FILE as JSON lines, see SolveStats::toJson()
+//   {"game":G,"move":K,"stats":{...}} for each move
+//   {"game":G,"win":W,"stats":{...}} at the end of each game
+//  --replay: log seeds, mines and moves of games to FILE,
+//   see replay_log.hpp and replay.cpp
+//  --lookahead-ms: compare the safest blocks for at most X ms
+//   before each guess, see Solver::setLookahead()
+//  --lookahead-depth: guesses looked ahead, default to 1
+//  --paired: play the same games without lookahead first and
+//   report the gain of win rate and the cost of latency
+// except in file mode, heap allocations of workers from
+//  passing a board to Solver until solve() returns are
+//  reported with the peak of scratch memory of a move
+
+// shared by all workers
+//  counters are only updated once per game
+struct Counter
 {
-private:
-    // special status of board
-    static const int MINE = 16;
-    static const int FLAG = 32;
-    static const int UNKNOWN = 64;
-
-    int mine_number;
-    int width, height;
-    vector<vector<int>> board;
-    vector<vector<bool>> vis;
-
-    // generate mines
-    //  excluding first click
-    void genMines(Block first_click)
-    {
-        // generate mines
-        vector<Block> mines;
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                if (i != first_click.first &&
-                    j != first_click.second)
-                    mines.emplace_back(make_pair(i, j));
-        std::shuffle(mines.begin(), mines.end(),
-                     std::mt19937(time(0)));
-        mines.resize(mine_number);
-        for (const auto &mine : mines)
-            board[mine.first][mine.second] = MINE;
-        // update board
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                if (board[i][j] == 0)
-                {
-                    int cnt = 0;
-                    for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
-                        for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
-                            cnt += board[x][y] == MINE;
-                    board[i][j] = cnt;
-                }
-    }
+    std::atomic<long long> next_game{0};
+    std::atomic<long long> finished{0};
+    std::atomic<long long> win_cnt{0};
+    std::atomic<long long> move_cnt{0};
+    std::atomic<long long> verify_error{0};
+    std::atomic<long long> cache_hit{0};
+    std::atomic<long long> cache_miss{0};
+    std::atomic<long long> approx_cnt{0};
+    std::atomic<long long> solve_ns{0};
+    std::atomic<long long> sampled_cnt{0};
+    std::atomic<long long> sample_cnt{0};
+    std::atomic<long long> sample_error_ppm{0};
+    std::atomic<long long> heap_allocs{0};
+    std::atomic<long long> alloc_moves{0};
+    // JSON lines of finished games
+    std::mutex metrics_lock;
+    ofstream metrics_file;
+    // records of finished games
+    std::mutex replay_lock;
+    ReplayWriter replay_writer;
+    // result of each game in paired runs
+    vector<char> game_win;
+};
+
+// each worker owns its Solver and Designer
+struct Worker
+{
+    Solver solver;
+    Designer designer;
+    // file names used in file mode
+    string board_file, steps_file, flags_file;
+    LatencyHistogram latency;
+    // latency of moves clicking a block which may be a mine
+    LatencyHistogram guess_latency;
+    // moves not solved exactly in time budget
+    long long approx_cnt = 0;
+    double solve_time = 0;
+    // moves guessed by sampling
+    long long sampled_cnt = 0;
+    long long sample_cnt = 0;
+    double sample_error = 0;
+    // heap allocations of solving, moves making any
+    long long heap_allocs = 0;
+    long long alloc_moves = 0;
+    // statistics of moves are collected if metrics is set
+    //  lines of current game are written when it ends
+    bool metrics = false;
+    long long game = 0;
+    string metrics_lines;
+    SolveStats stats;
+    // current game is recorded if replay is set
+    bool replay = false;
+    GameRecord record;
+    string replay_buf;
+};
 
-    // visit all neighbors of '0'
-    void dfsVisit(Block cur)
-    {
-        int x = cur.first, y = cur.second;
-        for (int i = max(x - 1, 0); i <= min(x + 1, height - 1); ++i)
-            for (int j = max(y - 1, 0); j <= min(y + 1, width - 1); ++j)
-                if (!vis[i][j])
-                {
-                    vis[i][j] = true;
-                    if (board[i][j] == 0)
-                        dfsVisit(make_pair(i, j));
-                }
+// statistics of last solve()
+void recordSolve(Worker &worker)
+{
+    const Solver &solver = worker.solver;
+    if (worker.replay)
+    {
+        worker.record.moves.emplace_back();
+        auto &move = worker.record.moves.back();
+        move.steps = solver.getNextSteps();
+        move.flags = solver.getNextFlags();
+        move.solve_ns = solver.getTimeUsed() * 1e9;
+    }
+    worker.approx_cnt += !solver.isExact();
+    worker.solve_time += solver.getTimeUsed();
+    if (solver.getSampleCount() > 0)
+    {
+        worker.sampled_cnt++;
+        worker.sample_cnt += solver.getSampleCount();
+        worker.sample_error += solver.getSampleError();
     }
+}
 
-public:
-    Designer(int width = 30, int height = 16,
-             int mine_number = 99)
+// JSON line of statistics
+string statsLine(long long game, const char *key, long long value,
+                 const SolveStats &stats)
+{
+    return "{\"game\":" + std::to_string(game) + ",\"" + key + "\":" +
+           std::to_string(value) + ",\"stats\":" + stats.toJson() + "}\n";
+}
+
+// play one move
+//  return true if encounter mines
+bool playMove(Worker &worker, bool is_first, Mode mode)
+{
+    Solver &solver = worker.solver;
+    Designer &designer = worker.designer;
+    if (mode == FILE_IO)
     {
-        this->width = width;
-        this->height = height;
-        this->mine_number = mine_number;
+        designer.printBoard(worker.board_file);
+        solver.readBoard(worker.board_file);
+        solver.solve();
+        recordSolve(worker);
+        solver.printNextStep(worker.steps_file);
+        solver.printNextFlag(worker.flags_file);
+        if (designer.clickBoard(is_first, worker.steps_file))
+            return true;
+        designer.putFlag(worker.flags_file);
+        return false;
     }
+    long long allocs = heapAllocCount();
+    if (mode == INCREMENTAL)
+        solver.updateBoard(designer.popChanges());
+    else
+        solver.readBoard(designer.getBoard(),
+                         designer.getMineNumber());
+    solver.solve();
+    allocs = heapAllocCount() - allocs;
+    worker.heap_allocs += allocs;
+    worker.alloc_moves += allocs > 0;
+    recordSolve(worker);
+    if (designer.clickBoard(is_first, solver.getNextSteps()))
+        return true;
+    designer.putFlag(solver.getNextFlags());
+    return false;
+}
 
-    // clear and initialize board
-    void initBoard()
+// play one game
+//  return true if win
+bool playGame(Worker &worker, Mode mode,
+              long long &move_cnt)
+{
+    bool is_first = true;
+    worker.designer.initBoard();
+    worker.solver.resetGameStats();
+    if (mode == INCREMENTAL)
+        worker.solver.newGame(worker.designer.getHeight(),
+                              worker.designer.getWidth(),
+                              worker.designer.getMineNumber());
+    while (!worker.designer.isFinished())
     {
-        // clear
-        vis.clear();
-        vis = vector<vector<bool>>(height,
-                                   vector<bool>(width, 0));
-        board.clear();
-        board = vector<vector<int>>(height,
-                                    vector<int>(width, 0));
+        Timer move_timer;
+        bool boom = playMove(worker, is_first, mode);
+        worker.latency.add(move_timer.elapsedNs());
+        if (worker.solver.isGuess())
+            worker.guess_latency.add(move_timer.elapsedNs());
+        if (worker.metrics)
+            worker.metrics_lines += statsLine(worker.game, "move", move_cnt,
+                                              worker.solver.getLastStats());
+        move_cnt++;
+        if (boom) // boom!
+            return false;
+        is_first = false;
     }
+    return true;
+}
 
-    // print board
-    void printBoard(string file_name = "board.txt")
+void runWorker(Worker &worker, Counter &counter,
+               long long T, unsigned long long seed,
+               Mode mode)
+{
+    while (true)
     {
-        ofstream fout(file_name);
-        if (!fout.is_open())
-            printError("Can't Open Output File!");
-        fout << height << ' ' << width << ' '
-             << mine_number << std::endl;
-        for (int i = 0; i < height; ++i)
+        long long i = counter.next_game.fetch_add(1);
+        if (i >= T)
+            break;
+        unsigned long long game_seed = splitMix64(seed + i);
+        worker.designer.setSeed(game_seed);
+        worker.solver.setSeed(splitMix64(game_seed));
+
+        long long move_cnt = 0;
+        worker.game = i;
+        worker.record.clear();
+        bool win = playGame(worker, mode, move_cnt);
+        if (worker.replay)
         {
-            for (int j = 0; j < width; ++j)
-            {
-                fout.width(3);
-                fout << (vis[i][j] ||
-                                 board[i][j] == FLAG
-                             ? board[i][j]
-                             : UNKNOWN)
-                     << ' ';
-            }
-            fout << std::endl;
+            GameRecord &record = worker.record;
+            record.index = i;
+            record.seed = game_seed;
+            record.width = worker.designer.getWidth();
+            record.height = worker.designer.getHeight();
+            record.mine_number = worker.designer.getMineNumber();
+            record.mines = worker.designer.getMines();
+            record.win = win;
+            worker.replay_buf.clear();
+            encodeGame(record, worker.replay_buf);
+            std::lock_guard<std::mutex> guard(counter.replay_lock);
+            counter.replay_writer.write(worker.replay_buf);
+        }
+        if (worker.metrics)
+        {
+            const SolveStats &stats = worker.solver.getGameStats();
+            worker.stats.merge(stats);
+            worker.metrics_lines += statsLine(i, "win", win, stats);
+            std::lock_guard<std::mutex> guard(counter.metrics_lock);
+            counter.metrics_file << worker.metrics_lines;
+            worker.metrics_lines.clear();
         }
-        fout.close();
+        if (!counter.game_win.empty())
+            counter.game_win[i] = win;
+        counter.win_cnt.fetch_add(win, std::memory_order_relaxed);
+        counter.move_cnt.fetch_add(move_cnt, std::memory_order_relaxed);
+        counter.finished.fetch_add(1, std::memory_order_release);
     }
+    counter.verify_error.fetch_add(worker.solver.getVerifyError());
+    counter.cache_hit.fetch_add(worker.solver.getCacheHits());
+    counter.cache_miss.fetch_add(worker.solver.getCacheMisses());
+    counter.approx_cnt.fetch_add(worker.approx_cnt);
+    counter.solve_ns.fetch_add(worker.solve_time * 1e9);
+    counter.sampled_cnt.fetch_add(worker.sampled_cnt);
+    counter.sample_cnt.fetch_add(worker.sample_cnt);
+    counter.sample_error_ppm.fetch_add(worker.sample_error * 1e6);
+    counter.heap_allocs.fetch_add(worker.heap_allocs);
+    counter.alloc_moves.fetch_add(worker.alloc_moves);
+}
 
-    // click points
-    //  return true if encounter mines
-    // moreover, if it is the first click,
-    //  then generate mines.
-    bool clickBoard(bool is_first,
-                    string file_name = "steps.txt")
-    {
-        ifstream fin(file_name);
-        if (!fin.is_open())
-            printError("File Not Found!");
-
-        vector<Block> points;
-        int x, y;
-        while (fin >> x >> y)
-            points.emplace_back(make_pair(x, y));
-        if (points.empty())
-            printWarning("No Next Step!");
-
-        if (is_first)
-            genMines(points.front());
-        for (const auto &it : points)
-            if (!vis[it.first][it.second])
-            {
-                vis[it.first][it.second] = true;
-                if (board[it.first][it.second] == 0)
-                    dfsVisit(it);
-                if (board[it.first][it.second] == MINE)
-                    return true;
-            }
-            else // warning may be caused by dfsVisit
-                printWarning("Click Existing Block(" +
-                             std::to_string(it.first) + "," +
-                             std::to_string(it.second) + ")");
-        return false;
-    }
+void printProgress(long long win_cnt, long long finished)
+{
+    std::cout << '\r' << win_cnt << '/' << finished << ' ';
+    std::cout << std::setprecision(4)
+              << (finished ? win_cnt * 1.0 / finished : 0)
+              << std::flush;
+}
 
-    // put flags
-    void putFlag(string file_name = "flags.txt")
-    {
-        ifstream fin(file_name);
-        if (!fin.is_open())
-            printError("File Not Found!");
-
-        vector<Block> points;
-        int x, y;
-        while (fin >> x >> y)
-            points.emplace_back(make_pair(x, y));
-        if (points.empty())
-            printWarning("No Next Flag!");
-
-        for (const auto &it : points)
-            if (!vis[it.first][it.second])
-                board[it.first][it.second] = FLAG;
-            else
-                printWarning("Put Flag on Existing Block(" +
-                             std::to_string(it.first) + "," +
-                             std::to_string(it.second) + ")");
+// play T games on workers, return time used
+double runGames(vector<Worker> &workers, Counter &counter,
+                long long T, unsigned long long seed, Mode mode)
+{
+    Timer total_timer;
+    vector<std::thread> threads;
+    for (auto &it : workers)
+        threads.emplace_back(runWorker, std::ref(it),
+                             std::ref(counter), T, seed, mode);
+    while (counter.finished.load(std::memory_order_acquire) < T)
+    {
+        printProgress(counter.win_cnt.load(std::memory_order_relaxed),
+                      counter.finished.load(std::memory_order_relaxed));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
+    for (auto &it : threads)
+        it.join();
+    printProgress(counter.win_cnt, counter.finished);
+    return total_timer.elapsed();
+}
 
-    // return true if all mines are found
-    bool isFinished()
+// latency of all moves and of guesses of workers
+void mergeLatency(const vector<Worker> &workers,
+                  LatencyHistogram &latency,
+                  LatencyHistogram &guess_latency)
+{
+    for (const auto &it : workers)
     {
-        int cnt = 0;
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                cnt += vis[i][j];
-        return cnt == height * width - mine_number;
+        latency.merge(it.latency);
+        guess_latency.merge(it.guess_latency);
     }
-};
+}
 
-Solver solver;
-Designer designer;
-int main()
+int main(int argc, char *argv[])
 {
     std::ios::sync_with_stdio(false);
-    int T = 1000, win_cnt = 0;
-    for (int i = 1; i <= T; ++i)
+    long long T = 1000;
+    Mode mode = MEMORY;
+    int thread_num = max(1u, std::thread::hardware_concurrency());
+    unsigned long long seed = time(0);
+    int width = 30, height = 16, mine_number = 99;
+    bool verify = false;
+    int solver_thread_num = 1;
+    long long cache_mb = 16;
+    double budget_ms = 0;
+    double sample_ms = 0;
+    int sample_above = 0;
+    string metrics_file;
+    string replay_file;
+    double lookahead_ms = 0;
+    int lookahead_depth = 1;
+    bool paired = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--file")
+            mode = FILE_IO;
+        else if (arg == "--incremental")
+            mode = INCREMENTAL;
+        else if (arg == "--threads" && i + 1 < argc)
+            thread_num = max(1, std::stoi(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = std::stoull(argv[++i]);
+        else if (arg == "--board" && i + 3 < argc)
+        {
+            width = std::stoi(argv[++i]);
+            height = std::stoi(argv[++i]);
+            mine_number = std::stoi(argv[++i]);
+        }
+        else if (arg == "--verify")
+            verify = true;
+        else if (arg == "--solver-threads" && i + 1 < argc)
+            solver_thread_num = max(1, std::stoi(argv[++i]));
+        else if (arg == "--cache-mb" && i + 1 < argc)
+            cache_mb = max(0LL, std::stoll(argv[++i]));
+        else if (arg == "--budget-ms" && i + 1 < argc)
+            budget_ms = max(0.0, std::stod(argv[++i]));
+        else if (arg == "--sample-ms" && i + 1 < argc)
+            sample_ms = max(0.0, std::stod(argv[++i]));
+        else if (arg == "--sample-above" && i + 1 < argc)
+            sample_above = max(0, std::stoi(argv[++i]));
+        else if (arg == "--metrics" && i + 1 < argc)
+            metrics_file = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replay_file = argv[++i];
+        else if (arg == "--lookahead-ms" && i + 1 < argc)
+            lookahead_ms = max(0.0, std::stod(argv[++i]));
+        else if (arg == "--lookahead-depth" && i + 1 < argc)
+            lookahead_depth = max(1, std::stoi(argv[++i]));
+        else if (arg == "--paired")
+            paired = true;
+        else
+            T = std::stoll(arg);
+    }
+
+    Counter counter;
+    if (!metrics_file.empty())
+    {
+        counter.metrics_file.open(metrics_file);
+        if (!counter.metrics_file.is_open())
+            printError("Can't Open Metrics File!");
+    }
+    if (!replay_file.empty())
     {
-        bool is_first = true;
-        designer.initBoard();
-        while (!designer.isFinished())
+        ReplayOptions options;
+        options.mode = mode;
+        options.solver_thread_num = solver_thread_num;
+        options.cache_mb = cache_mb;
+        options.budget_us = budget_ms * 1e3;
+        options.sample_us = sample_ms * 1e3;
+        options.sample_above = sample_above;
+        options.lookahead_us = lookahead_ms * 1e3;
+        options.lookahead_depth = lookahead_depth;
+        if (!counter.replay_writer.open(replay_file, options))
+            printError("Can't Open Replay File!");
+    }
+    // the baseline of paired runs neither writes metrics
+    //  nor replays
+    auto setupWorkers = [&](vector<Worker> &workers, bool baseline)
+    {
+        for (int i = 0; i < thread_num; ++i)
         {
-            designer.printBoard();
-            solver.readBoard();
-            solver.solve();
-            solver.printNextStep();
-            solver.printNextFlag();
-            if (designer.clickBoard(is_first)) // boom!
+            workers[i].designer = Designer(width, height, mine_number);
+            workers[i].solver.setVerify(verify);
+            workers[i].solver.setThreads(solver_thread_num);
+            workers[i].solver.setCacheLimit(cache_mb << 20);
+            workers[i].solver.setTimeBudget(budget_ms / 1e3);
+            workers[i].solver.setSampling(sample_ms / 1e3);
+            workers[i].solver.setSampleThreshold(sample_above);
+            if (!baseline)
             {
-                win_cnt--; // offset cnt++
-                break;
+                workers[i].solver.setLookahead(lookahead_ms / 1e3,
+                                               lookahead_depth);
+                workers[i].solver.setMetrics(!metrics_file.empty());
+                workers[i].metrics = !metrics_file.empty();
+                workers[i].replay = !replay_file.empty();
             }
-            designer.putFlag();
-            is_first = false;
+            // workers must not share files
+            string suffix = thread_num > 1 ? std::to_string(i) : "";
+            workers[i].board_file = "board" + suffix + ".txt";
+            workers[i].steps_file = "steps" + suffix + ".txt";
+            workers[i].flags_file = "flags" + suffix + ".txt";
         }
-        win_cnt++;
-        std::cout << '\r' << win_cnt << '/' << i << ' ';
-        std::cout << std::setprecision(4)
-                  << win_cnt * 1.0 / i << std::flush;
+    };
+
+    // same seeds, so game i has the same mines in both runs
+    Counter base_counter;
+    vector<Worker> base_workers(paired ? thread_num : 0);
+    if (paired)
+    {
+        setupWorkers(base_workers, true);
+        base_counter.game_win.assign(T, 0);
+        counter.game_win.assign(T, 0);
+        std::cout << "without lookahead" << std::endl;
+        runGames(base_workers, base_counter, T, seed, mode);
+        std::cout << "\nwith lookahead" << std::endl;
+    }
+    vector<Worker> workers(thread_num);
+    setupWorkers(workers, false);
+    double total_time = runGames(workers, counter, T, seed, mode);
+
+    LatencyHistogram latency, guess_latency;
+    mergeLatency(workers, latency, guess_latency);
+    long long move_cnt = counter.move_cnt;
+    std::cout << std::endl
+              << std::fixed << std::setprecision(2)
+              << "mode: " << MODE_NAME[mode] << '\n'
+              << "threads: " << thread_num << '\n'
+              << "solver threads: " << solver_thread_num << '\n'
+              << "seed: " << seed << '\n'
+              << "time: " << total_time << "s\n"
+              << "games/sec: " << T / total_time << '\n'
+              << "moves/sec: " << move_cnt / total_time << '\n'
+              << "move latency(us):"
+              << " mean " << latency.mean() / 1e3
+              << " p50 " << latency.percentile(0.5) / 1e3
+              << " p90 " << latency.percentile(0.9) / 1e3
+              << " p99 " << latency.percentile(0.99) / 1e3
+              << " max " << latency.maxValue() / 1e3
+              << '\n'
+              << "partition cache: hits " << counter.cache_hit
+              << " misses " << counter.cache_miss << std::endl;
+    if (lookahead_ms > 0)
+    {
+        long long hits = 0, probes = 0;
+        for (const auto &it : workers)
+        {
+            hits += it.solver.getLookaheadHits();
+            probes += it.solver.getLookaheadProbes();
+        }
+        std::cout << "lookahead: " << lookahead_ms << "ms depth "
+                  << lookahead_depth << " guesses " << guess_latency.count()
+                  << " latency(us) mean " << guess_latency.mean() / 1e3
+                  << " p99 " << guess_latency.percentile(0.99) / 1e3
+                  << " table hits " << hits << '/' << probes << std::endl;
+    }
+    if (paired)
+    {
+        LatencyHistogram base_latency, base_guess_latency;
+        mergeLatency(base_workers, base_latency, base_guess_latency);
+        // games won only by one side, the difference of wins
+        //  over sqrt of their sum is a z-score
+        long long gained = 0, lost = 0;
+        for (long long i = 0; i < T; ++i)
+        {
+            gained += counter.game_win[i] && !base_counter.game_win[i];
+            lost += !counter.game_win[i] && base_counter.game_win[i];
+        }
+        std::cout << "paired: win rate " << base_counter.win_cnt * 100.0 / T
+                  << "% -> " << counter.win_cnt * 100.0 / T << "% gain "
+                  << (counter.win_cnt - base_counter.win_cnt) * 100.0 / T
+                  << "% (won only with lookahead " << gained
+                  << ", only without " << lost << ", z "
+                  << (gained + lost ? (gained - lost) / std::sqrt((double)gained + lost) : 0)
+                  << ")\n"
+                  << "paired: guess latency(us) mean "
+                  << base_guess_latency.mean() / 1e3 << " -> "
+                  << guess_latency.mean() / 1e3 << " p99 "
+                  << base_guess_latency.percentile(0.99) / 1e3 << " -> "
+                  << guess_latency.percentile(0.99) / 1e3
+                  << ", move latency(us) mean " << base_latency.mean() / 1e3
+                  << " -> " << latency.mean() / 1e3 << std::endl;
+    }
+    if (mode != FILE_IO && move_cnt > 0)
+    {
+        size_t scratch_peak = 0;
+        for (const auto &it : workers)
+            scratch_peak = max(scratch_peak, it.solver.getScratchPeak());
+        std::cout << "heap allocations/move: "
+                  << counter.heap_allocs * 1.0 / move_cnt
+                  << " moves allocating "
+                  << counter.alloc_moves * 100.0 / move_cnt
+                  << "% scratch peak " << scratch_peak / 1024 << "KB"
+                  << std::endl;
+    }
+    if (budget_ms > 0)
+        std::cout << "time budget: " << budget_ms << "ms"
+                  << " approximate moves " << counter.approx_cnt
+                  << '/' << move_cnt
+                  << " budget used "
+                  << (move_cnt ? counter.solve_ns / 1e6 / move_cnt / budget_ms * 100 : 0)
+                  << '%' << std::endl;
+    if (counter.sampled_cnt > 0)
+        std::cout << "sampled moves: " << counter.sampled_cnt
+                  << " samples/move " << counter.sample_cnt / counter.sampled_cnt
+                  << " mean 95% CI half width "
+                  << std::setprecision(4)
+                  << counter.sample_error_ppm / 1e6 / counter.sampled_cnt
+                  << std::endl;
+    if (!metrics_file.empty() && move_cnt > 0)
+    {
+        SolveStats stats;
+        for (const auto &it : workers)
+            stats.merge(it.stats);
+        std::cout << std::setprecision(2) << "phase time(us/move):";
+        for (int p = 0; p < PHASE_NUM; ++p)
+            std::cout << ' ' << PHASE_NAME[p] << ' '
+                      << stats.phase_ns[p] / 1e3 / move_cnt;
+        std::cout << "\nfound blocks:";
+        for (int p = 0; p < PHASE_NUM; ++p)
+            std::cout << ' ' << PHASE_NAME[p] << ' ' << stats.found[p];
+        std::cout << "\nsearch/move: nodes " << stats.node_cnt * 1.0 / move_cnt
+                  << " pruned " << stats.prune_cnt * 1.0 / move_cnt
+                  << " counted partitions " << stats.counted_cnt * 1.0 / move_cnt
+                  << "\nmoves solved by deduce: " << stats.deduced_cnt
+                  << "\npartition sizes:";
+        for (int b = 0; b < SolveStats::SIZE_BUCKETS; ++b)
+            if (stats.partition_cnt[b] > 0)
+                std::cout << ' ' << (1 << b) << '-' << (2 << b) - 1
+                          << ' ' << stats.partition_cnt[b];
+        std::cout << std::endl;
     }
+    if (verify)
+        std::cout << "mismatched partitions: "
+                  << counter.verify_error << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -5,12 +5,20 @@ from settings import *
 from utils import *
 
 win_cnt = 0
+server = startServer() if USE_SERVER else None
+lib, handle = loadLibrary() if USE_LIBRARY else (None, None)
 for i in range(10):
     board = Board()
     try:
         while True:
             board.grabBoardImage()
             board.scanBoard()
+            if server or lib:
+                steps, flags = askServer(server, board.board) if server \
+                    else askLibrary(lib, handle, board.board)
+                board.setBlocks(flags, FLAG)
+                clickBoard(steps=steps)
+                continue
             board.printBoard()
             os.system("solver.exe")
             board.setBlocks(getFlag(), FLAG)
@@ -0,0 +1,178 @@
+// count solutions of a small partition on bit masks
+#ifndef __MASK_COUNTER_HPP__
+#define __MASK_COUNTER_HPP__
+
+#include "common.h"
+#include "bitboard.hpp"
+#include "propagator.hpp"
+
+// the same search as Propagator for at most 64 variables,
+//  an assignment is a pair of words (mines, assigned) and
+//  each constraint is a word of its variables, so checking a
+//  constraint is two popcounts and forcing its variables is
+//  one or, undoing is free as words are passed by value
+// solutions are tallied in bit-sliced counters, one per #
+//  of mines: adding a solution adds 1 to the counters of all
+//  its mines at once with a ripple carry over the slices,
+//  they are flushed into block_cnt before they overflow
+// bit p is variable order[p], so taking the lowest free bit
+//  follows the constraint graph as in Propagator
+// stop and deadline work as in Propagator
+class MaskCounter : public Propagator
+{
+private:
+    // a solution adds at most this many carries
+    static const int SLICES = 16;
+
+    vector<Word> con_mask;      // bits of variables of each constraint
+    vector<int> con_lo, con_hi; // bounds of mines on them
+    vector<int> bit_of;         // bit of each variable
+    Word all;
+
+    vector<long long> *cnt;
+    vector<long long> *block_cnt;
+    // slices[m * SLICES + b]: b th bit of the # of solutions
+    //  with m mines and each variable as a mine, since flush
+    vector<Word> slices;
+    vector<int> unflushed; // solutions in slices of m mines
+
+    // add slices of m mines to block_cnt and clear them
+    void flush(int m)
+    {
+        Word *s = &slices[m * SLICES];
+        for (int b = 0; b < SLICES; ++b)
+            for (Word w = s[b]; w; w &= w - 1)
+                (*block_cnt)[order[lowBit(w)] * (var_num + 1) + m] += 1LL << b;
+        std::fill(s, s + SLICES, 0);
+        unflushed[m] = 0;
+    }
+
+    void addSolution(Word mine)
+    {
+        int m = popCount(mine);
+        (*cnt)[m]++;
+        Word *s = &slices[m * SLICES];
+        for (Word carry = mine; carry; ++s)
+        {
+            Word t = *s & carry;
+            *s ^= carry;
+            carry = t;
+        }
+        if (++unflushed[m] == (1 << SLICES) - 1)
+            flush(m);
+    }
+
+    // check constraints of variables in todo, forcing the
+    //  unassigned variables of tight ones, until none is left
+    //  return false if any constraint is violated
+    bool settle(Word &mine, Word &known, Word todo)
+    {
+        while (todo)
+        {
+            int v = order[lowBit(todo)];
+            todo &= todo - 1;
+            for (int i = con_begin[v]; i < con_begin[v + 1]; ++i)
+            {
+                int c = con_of[i];
+                Word m = con_mask[c];
+                Word free = m & ~known;
+                int mines = popCount(m & mine);
+                int free_cnt = popCount(free);
+                if (mines > con_hi[c] || mines + free_cnt < con_lo[c])
+                    return false;
+                if (!free)
+                    continue;
+                if (mines == con_hi[c])
+                {
+                    known |= free;
+                    todo |= free;
+                }
+                else if (mines + free_cnt == con_lo[c])
+                {
+                    known |= free;
+                    mine |= free;
+                    todo |= free;
+                }
+            }
+        }
+        return true;
+    }
+
+    void search(Word mine, Word known)
+    {
+        if (stopped())
+            return;
+        node_cnt++;
+        Word free = all & ~known;
+        if (!free)
+        {
+            addSolution(mine);
+            return;
+        }
+
+        // lowest unassigned variable, mine first, then safe
+        Word bit = free & -free;
+        for (int val = 1; val >= 0; --val)
+        {
+            Word next_mine = val ? mine | bit : mine;
+            Word next_known = known | bit;
+            if (settle(next_mine, next_known, bit))
+                search(next_mine, next_known);
+            else
+                prune_cnt++;
+        }
+    }
+
+public:
+    static const int MAX_VARS = 64;
+
+    // count solutions of constraints as Propagator::count()
+    //  cons must have at most MAX_VARS variables
+    bool count(const Constraints &cons,
+               vector<long long> &cnt,
+               vector<long long> &block_cnt)
+    {
+        int n = var_num = cons.var_num;
+        cnt.assign(n + 1, 0);
+        block_cnt.assign(n * (n + 1), 0);
+        this->cnt = &cnt;
+        this->block_cnt = &block_cnt;
+        node_cnt = 0;
+        prune_cnt = 0;
+        timeout = false;
+
+        int con_num = cons.vars.size();
+        con_mask.assign(con_num, 0);
+        con_lo.resize(con_num);
+        con_hi.resize(con_num);
+        indexConstraints(cons);
+        orderVariables(cons);
+        bit_of.resize(n);
+        for (int p = 0; p < n; ++p)
+            bit_of[order[p]] = p;
+        for (int c = 0; c < con_num; ++c)
+        {
+            for (int v : cons.vars[c])
+                con_mask[c] |= 1ULL << bit_of[v];
+            // mines outside are free, so only bounds are known
+            con_hi[c] = cons.need[c];
+            con_lo[c] = cons.need[c] - cons.outside[c];
+            if (con_hi[c] < 0 || con_lo[c] > (int)cons.vars[c].size())
+                return finished();
+        }
+        all = n == 64 ? ~0ULL : (1ULL << n) - 1;
+        slices.assign((n + 1) * SLICES, 0);
+        unflushed.assign(n + 1, 0);
+
+        // constraints may be tight before search
+        Word mine = 0, known = 0;
+        if (settle(mine, known, all))
+            search(mine, known);
+        for (int m = 0; m <= n; ++m)
+            if (unflushed[m] > 0)
+                flush(m);
+        return finished();
+    }
+};
+
+#endif
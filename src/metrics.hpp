@@ -0,0 +1,130 @@
+// statistics of solve() to find out why a move is slow
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include "common.h"
+
+// phases of a move, in the order they run
+//  readBoard covers readBoard(), newGame() and updateBoard()
+//  deduce finds certain blocks of partitions before counting
+//  estimate covers sampling or estimating partitions not counted
+enum Phase
+{
+    READ_BOARD,
+    DETECT_SAFE,
+    DETECT_UNSAFE,
+    DIVIDE_BORDER,
+    DEDUCE,
+    CALC_LOCAL_PROB,
+    ESTIMATE,
+    CALC_GLOBAL_PROB,
+    RANDOM_NEXT,
+    PHASE_NUM
+};
+const char *const PHASE_NAME[PHASE_NUM] = {
+    "readBoard", "detectSafe", "detectUnsafe", "divideBorder",
+    "deduce", "calcLocalProb", "estimate", "calcGlobalProb",
+    "randomNext"};
+
+// statistics of one move, or summed over moves by merge()
+struct SolveStats
+{
+    // partitions of size in [2^b, 2^(b+1)) fall in bucket b
+    static const int SIZE_BUCKETS = 16;
+
+    long long move_cnt = 0;
+    long long approx_cnt = 0;  // moves not solved exactly
+    long long deduced_cnt = 0; // moves solved by deduce without search
+    long long total_ns = 0;    // time of solve()
+    long long phase_ns[PHASE_NUM] = {};
+    // blocks to click or flag found in each phase
+    //  those of randomNext are guesses
+    long long found[PHASE_NUM] = {};
+    // search nodes and branches cut by constraints
+    long long node_cnt = 0;
+    long long prune_cnt = 0;
+    long long counted_cnt = 0; // partitions counted by search
+    long long cache_hit = 0;   // partitions found in cache
+    long long sample_cnt = 0;
+    // bytes of scratch memory, the largest move if merged
+    long long scratch_bytes = 0;
+    long long partition_cnt[SIZE_BUCKETS] = {};
+
+    void clear()
+    {
+        *this = SolveStats();
+    }
+
+    void addPartition(int size)
+    {
+        int b = 0;
+        while ((size >> (b + 1)) > 0 && b + 1 < SIZE_BUCKETS)
+            b++;
+        partition_cnt[b]++;
+    }
+
+    void merge(const SolveStats &other)
+    {
+        move_cnt += other.move_cnt;
+        approx_cnt += other.approx_cnt;
+        deduced_cnt += other.deduced_cnt;
+        total_ns += other.total_ns;
+        for (int p = 0; p < PHASE_NUM; ++p)
+        {
+            phase_ns[p] += other.phase_ns[p];
+            found[p] += other.found[p];
+        }
+        node_cnt += other.node_cnt;
+        prune_cnt += other.prune_cnt;
+        counted_cnt += other.counted_cnt;
+        cache_hit += other.cache_hit;
+        sample_cnt += other.sample_cnt;
+        scratch_bytes = max(scratch_bytes, other.scratch_bytes);
+        for (int b = 0; b < SIZE_BUCKETS; ++b)
+            partition_cnt[b] += other.partition_cnt[b];
+    }
+
+    // one line of JSON, times in ns
+    //  {"moves":1,"approx":0,"deduced":0,"ns":...,
+    //   "phases":{"readBoard":{"ns":...,"found":...},...},
+    //   "nodes":...,"pruned":...,"counted":...,"cache_hits":...,
+    //   "samples":...,"scratch_bytes":...,"partition_sizes":[...]}
+    // trailing empty buckets of partition_sizes are left out
+    string toJson() const
+    {
+        string s = "{\"moves\":" + std::to_string(move_cnt) +
+                   ",\"approx\":" + std::to_string(approx_cnt) +
+                   ",\"deduced\":" + std::to_string(deduced_cnt) +
+                   ",\"ns\":" + std::to_string(total_ns) +
+                   ",\"phases\":{";
+        for (int p = 0; p < PHASE_NUM; ++p)
+        {
+            if (p > 0)
+                s += ',';
+            s += '"';
+            s += PHASE_NAME[p];
+            s += "\":{\"ns\":" + std::to_string(phase_ns[p]) +
+                 ",\"found\":" + std::to_string(found[p]) + '}';
+        }
+        s += "},\"nodes\":" + std::to_string(node_cnt) +
+             ",\"pruned\":" + std::to_string(prune_cnt) +
+             ",\"counted\":" + std::to_string(counted_cnt) +
+             ",\"cache_hits\":" + std::to_string(cache_hit) +
+             ",\"samples\":" + std::to_string(sample_cnt) +
+             ",\"scratch_bytes\":" + std::to_string(scratch_bytes) +
+             ",\"partition_sizes\":[";
+        int n = SIZE_BUCKETS;
+        while (n > 0 && partition_cnt[n - 1] == 0)
+            n--;
+        for (int b = 0; b < n; ++b)
+        {
+            if (b > 0)
+                s += ',';
+            s += std::to_string(partition_cnt[b]);
+        }
+        s += "]}";
+        return s;
+    }
+};
+
+#endif
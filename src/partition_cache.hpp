@@ -0,0 +1,141 @@
+// cache of partition counts across moves
+#ifndef __PARTITION_CACHE_HPP__
+#define __PARTITION_CACHE_HPP__
+
+#include "common.h"
+#include "propagator.hpp"
+#include "counter.hpp"
+
+#include <list>
+#include <unordered_map>
+
+// least recently used cache of solutions of partitions
+//  keyed by their constraints: # of blocks, and for each number
+//  mines still needed, unknowns of other partitions and its blocks
+// the key only uses indices inside the partition,
+//  so partitions with the same shape share their counts
+// entries are evicted when the estimated memory exceeds limit
+// only counts of solved partitions are inserted, so cached
+//  counts fit in long long as in Solver::border_cnt
+class PartitionCache
+{
+private:
+    struct Entry
+    {
+        const vector<int> *key;
+        vector<long long> cnt;
+        vector<long long> block_cnt;
+        size_t bytes;
+    };
+    typedef std::list<Entry>::iterator Iter;
+
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<vector<int>, Iter, VectorHash> index;
+    size_t limit;
+    size_t used;
+    long long hit_cnt, miss_cnt;
+
+    // rough memory of an entry
+    static size_t entryBytes(const vector<int> &key,
+                             const vector<long long> &cnt,
+                             const vector<long long> &block_cnt)
+    {
+        return sizeof(Entry) + 64 + // list and map nodes
+               key.size() * sizeof(int) +
+               (cnt.size() + block_cnt.size()) * sizeof(long long);
+    }
+
+    void evict()
+    {
+        const Entry &last = entries.back();
+        used -= last.bytes;
+        index.erase(*last.key);
+        entries.pop_back();
+    }
+
+public:
+    PartitionCache(size_t limit = 16 << 20)
+        : limit(limit), used(0), hit_cnt(0), miss_cnt(0)
+    {
+    }
+
+    // key of cons, written into key to reuse its buffer
+    static void makeKey(const Constraints &cons, vector<int> &key)
+    {
+        key.assign(1, cons.var_num);
+        for (int c = 0; c < cons.vars.size(); ++c)
+        {
+            key.push_back(cons.need[c]);
+            key.push_back(cons.outside[c]);
+            key.push_back(cons.vars[c].size());
+            key.insert(key.end(), cons.vars[c].begin(), cons.vars[c].end());
+        }
+    }
+
+    // copy counts of key to cnt and block_cnt
+    //  return false if not found
+    bool find(const vector<int> &key,
+              vector<long long> &cnt,
+              vector<long long> &block_cnt)
+    {
+        auto it = index.find(key);
+        if (it == index.end())
+        {
+            miss_cnt++;
+            return false;
+        }
+        hit_cnt++;
+        entries.splice(entries.begin(), entries, it->second);
+        cnt = it->second->cnt;
+        block_cnt = it->second->block_cnt;
+        return true;
+    }
+
+    void insert(const vector<int> &key,
+                const vector<long long> &cnt,
+                const vector<long long> &block_cnt)
+    {
+        size_t bytes = entryBytes(key, cnt, block_cnt);
+        if (bytes > limit || index.count(key))
+            return;
+        while (used + bytes > limit)
+            evict();
+        auto it = index.emplace(key, entries.end()).first;
+        entries.push_front(Entry{&it->first, cnt, block_cnt, bytes});
+        it->second = entries.begin();
+        used += bytes;
+    }
+
+    // limit of memory in bytes, 0 to disable cache
+    void setLimit(size_t limit)
+    {
+        this->limit = limit;
+        while (used > limit)
+            evict();
+    }
+
+    void clear()
+    {
+        entries.clear();
+        index.clear();
+        used = 0;
+    }
+
+    long long getHitCount() const
+    {
+        return hit_cnt;
+    }
+
+    long long getMissCount() const
+    {
+        return miss_cnt;
+    }
+
+    // estimated memory in bytes
+    size_t getMemory() const
+    {
+        return used;
+    }
+};
+
+#endif
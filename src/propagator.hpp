@@ -0,0 +1,418 @@
+// count solutions of a partition with constraint propagation
+#ifndef __PROPAGATOR_HPP__
+#define __PROPAGATOR_HPP__
+
+#include "common.h"
+
+#include <atomic>
+#include <chrono>
+
+// lists of ints stored back to back in one buffer
+//  list i is items[start[i]] ~ items[start[i + 1] - 1]
+// a list is read like a const vector, and clear() keeps the
+//  buffer, so lists rebuilt every move do not allocate
+class FlatLists
+{
+private:
+    vector<int> items;
+    vector<int> start = {0};
+
+public:
+    struct List
+    {
+        const int *first, *last;
+
+        const int *begin() const
+        {
+            return first;
+        }
+
+        const int *end() const
+        {
+            return last;
+        }
+
+        size_t size() const
+        {
+            return last - first;
+        }
+
+        bool empty() const
+        {
+            return first == last;
+        }
+
+        int operator[](int i) const
+        {
+            return first[i];
+        }
+    };
+
+    size_t size() const
+    {
+        return start.size() - 1;
+    }
+
+    List operator[](int i) const
+    {
+        const int *p = items.data();
+        return List{p + start[i], p + start[i + 1]};
+    }
+
+    void clear()
+    {
+        items.clear();
+        start.resize(1);
+    }
+
+    // append an empty list, push() adds to it
+    void addList()
+    {
+        start.push_back(items.size());
+    }
+
+    void push(int v)
+    {
+        items.push_back(v);
+        start.back()++;
+    }
+};
+
+// constraints of a partition
+//  variables are blocks of the partition (0 ~ var_num-1)
+//  i th constraint is a number next to the partition,
+//  # of mines in vars[i] plus mines in its outside[i]
+//  unknown neighbors of other partitions must be need[i]
+struct Constraints
+{
+    int var_num;
+    FlatLists vars;
+    vector<int> need;
+    vector<int> outside;
+};
+
+// constraints of each variable of cons, stored back to back
+//  constraints of v are con_of[con_begin[v]] ~ con_of[con_begin[v + 1] - 1]
+// buffers keep their capacity, so rebuilding takes nothing
+//  from heap once they are large enough
+inline void buildConstraintIndex(const Constraints &cons,
+                                 vector<int> &con_begin,
+                                 vector<int> &con_of)
+{
+    int n = cons.var_num;
+    // con_begin[v] is the end of the range of v, then
+    //  moves to its beginning as the range is filled
+    con_begin.assign(n + 1, 0);
+    for (int c = 0; c < cons.vars.size(); ++c)
+        for (int v : cons.vars[c])
+            con_begin[v]++;
+    for (int v = 1; v <= n; ++v)
+        con_begin[v] += con_begin[v - 1];
+    con_of.resize(con_begin[n]);
+    for (int c = 0; c < cons.vars.size(); ++c)
+        for (int v : cons.vars[c])
+            con_of[--con_begin[v]] = c;
+}
+
+// depth first search over variables
+//  each constraint keeps # of mines still needed and
+//  # of unknowns remaining, they are updated in O(1)
+//  when a variable is assigned or undone
+// once a constraint becomes tight (needs 0 mines,
+//  or needs all its unknowns) its variables are forced
+class Propagator
+{
+protected:
+    const Constraints *cons;
+    int var_num;
+    vector<int> need;             // mines still needed
+    vector<int> left;             // unknowns remaining
+    vector<int> value;            // 1: mine, 0: safe, -1: unassigned
+    vector<int> trail;            // assigned variables, in order
+    vector<int> pending;          // tight constraints to propagate
+    int cur_mine;
+    long long node_cnt;
+    long long prune_cnt; // branches violating constraints
+    // search stops early once it is set, see setStop()
+    const std::atomic<bool> *stop = nullptr;
+    // and after deadline, see setDeadline()
+    bool has_deadline = false;
+    std::chrono::steady_clock::time_point deadline;
+    bool timeout;
+
+    // constraints of variable v are
+    //  con_of[con_begin[v]] ~ con_of[con_begin[v + 1] - 1]
+    //  see consOf()
+    vector<int> con_begin, con_of;
+    vector<int> order; // variables in the order they are assigned
+    // scratch of orderVariables()
+    vector<int> mark, queue, next;
+    // smaller partitions keep their order, sorting them
+    //  costs more than the few nodes it saves
+    static const int ORDER_THRESHOLD = 16;
+
+    // fill con_begin and con_of
+    void indexConstraints(const Constraints &cons)
+    {
+        buildConstraintIndex(cons, con_begin, con_of);
+    }
+
+    // constraints of variable v, read like a const vector
+    //  constraints must be indexed by indexConstraints()
+    FlatLists::List consOf(int v) const
+    {
+        const int *p = con_of.data();
+        return FlatLists::List{p + con_begin[v], p + con_begin[v + 1]};
+    }
+
+    // order of variables for a listing search, breadth first
+    //  along the constraint graph, so constraints are closed
+    //  soon after they are opened
+    // a component starts from the last variable reached from
+    //  its first one, which lies at one end of it and keeps
+    //  the bandwidth small, neighbors with more constraints
+    //  go first
+    // constraints must be indexed by indexConstraints()
+    void orderVariables(const Constraints &cons)
+    {
+        int n = cons.var_num;
+        order.clear();
+        if (n <= ORDER_THRESHOLD)
+        {
+            for (int v = 0; v < n; ++v)
+                order.push_back(v);
+            return;
+        }
+        mark.assign(n, -1);
+        auto degree = [&](int v)
+        { return con_begin[v + 1] - con_begin[v]; };
+        // variables reached from s, breadth first
+        auto bfs = [&](int s, int stamp)
+        {
+            queue.clear();
+            queue.push_back(s);
+            mark[s] = stamp;
+            for (int k = 0; k < queue.size(); ++k)
+            {
+                next.clear();
+                int u = queue[k];
+                for (int i = con_begin[u]; i < con_begin[u + 1]; ++i)
+                    for (int v : cons.vars[con_of[i]])
+                        if (mark[v] != stamp)
+                        {
+                            mark[v] = stamp;
+                            next.push_back(v);
+                        }
+                // insertion sort, stable and needs no buffer
+                for (int i = 1; i < next.size(); ++i)
+                    for (int j = i; j > 0 && degree(next[j - 1]) < degree(next[j]); --j)
+                        std::swap(next[j - 1], next[j]);
+                queue.insert(queue.end(), next.begin(), next.end());
+            }
+        };
+        // a variable is placed once its mark is n
+        for (int v = 0; v < n; ++v)
+            if (mark[v] != n)
+            {
+                bfs(v, v);
+                bfs(queue.back(), n);
+                order.insert(order.end(), queue.begin(), queue.end());
+            }
+    }
+
+    bool stopped()
+    {
+        if (stop && stop->load(std::memory_order_relaxed))
+            return true;
+        // reading clock is slow, check it every 1024 nodes
+        if (has_deadline && !timeout && (node_cnt & 1023) == 0)
+            timeout = std::chrono::steady_clock::now() > deadline;
+        return timeout;
+    }
+
+    // whether last search is not stopped
+    bool finished() const
+    {
+        return !timeout && !(stop && stop->load(std::memory_order_relaxed));
+    }
+
+    // assign variable v and update its constraints
+    //  return false if any constraint is violated
+    bool assign(int v, int val)
+    {
+        value[v] = val;
+        cur_mine += val;
+        trail.push_back(v);
+        bool ok = true;
+        for (int c : consOf(v))
+        {
+            left[c]--;
+            need[c] -= val;
+            if (need[c] < 0 || need[c] > left[c])
+                ok = false;
+            else if (need[c] == 0 || need[c] == left[c])
+                pending.push_back(c);
+        }
+        return ok;
+    }
+
+    // undo assignments after the first mark variables of trail
+    void undo(int mark)
+    {
+        while (trail.size() > mark)
+        {
+            int v = trail.back();
+            trail.pop_back();
+            for (int c : consOf(v))
+            {
+                left[c]++;
+                need[c] += value[v];
+            }
+            cur_mine -= value[v];
+            value[v] = -1;
+        }
+    }
+
+    // force variables of tight constraints
+    //  return false if it leads to a conflict
+    bool propagate()
+    {
+        while (!pending.empty())
+        {
+            int c = pending.back();
+            pending.pop_back();
+            // all remaining unknowns are safe or mines
+            int val = need[c] == 0 ? 0 : 1;
+            for (int v : cons->vars[c])
+                if (value[v] < 0 && !assign(v, val))
+                {
+                    pending.clear();
+                    return false;
+                }
+        }
+        return true;
+    }
+
+    // set up counters of constraints and index them
+    //  return false if they can not be satisfied
+    bool init(const Constraints &cons)
+    {
+        this->cons = &cons;
+        var_num = cons.var_num;
+        indexConstraints(cons);
+        int con_num = cons.vars.size();
+        need = cons.need;
+        left = cons.outside;
+        pending.clear();
+        for (int c = 0; c < con_num; ++c)
+            left[c] += cons.vars[c].size();
+        value.assign(var_num, -1);
+        trail.clear();
+        cur_mine = 0;
+        node_cnt = 0;
+        prune_cnt = 0;
+        timeout = false;
+
+        // constraints may be tight or violated before search
+        for (int c = 0; c < con_num; ++c)
+        {
+            if (need[c] < 0 || need[c] > left[c])
+                return false;
+            if (need[c] == 0 || need[c] == left[c])
+                pending.push_back(c);
+        }
+        return propagate();
+    }
+
+private:
+    vector<long long> *cnt;
+    vector<long long> *block_cnt;
+
+    // assign the k th variable of order and later ones
+    void search(int k)
+    {
+        if (stopped())
+            return;
+        node_cnt++;
+        while (k < var_num && value[order[k]] >= 0)
+            k++;
+        if (k == var_num)
+        {
+            for (int v = 0; v < var_num; ++v)
+                if (value[v] == 1)
+                    (*block_cnt)[v * (var_num + 1) + cur_mine]++;
+            (*cnt)[cur_mine]++;
+            return;
+        }
+
+        // try mine first, then safe
+        for (int val = 1; val >= 0; --val)
+        {
+            int mark = trail.size();
+            if (assign(order[k], val) && propagate())
+                search(k + 1);
+            else
+                prune_cnt++;
+            pending.clear();
+            undo(mark);
+        }
+    }
+
+public:
+    // count solutions of constraints
+    //  cnt[j]: # of solutions with j mines
+    //  block_cnt[i * (var_num + 1) + j]: # of solutions
+    //   with j mines and i th variable is a mine
+    // both are resized and cleared, flat tables keep their
+    //  buffers when they are counted again
+    // return false if it is stopped before finishing
+    bool count(const Constraints &cons,
+               vector<long long> &cnt,
+               vector<long long> &block_cnt)
+    {
+        cnt.assign(cons.var_num + 1, 0);
+        block_cnt.assign(cons.var_num * (cons.var_num + 1), 0);
+        this->cnt = &cnt;
+        this->block_cnt = &block_cnt;
+        bool ok = init(cons);
+        orderVariables(cons);
+        if (ok)
+            search(0);
+        pending.clear();
+        undo(0);
+        return finished();
+    }
+
+    // stop running count() when *stop becomes true
+    //  so other threads can cancel it, nullptr to disable
+    void setStop(const std::atomic<bool> *stop)
+    {
+        this->stop = stop;
+    }
+
+    // stop running count() after deadline
+    void setDeadline(std::chrono::steady_clock::time_point deadline)
+    {
+        has_deadline = true;
+        this->deadline = deadline;
+    }
+
+    void clearDeadline()
+    {
+        has_deadline = false;
+    }
+
+    // # of search nodes of last count()
+    long long getNodeCount() const
+    {
+        return node_cnt;
+    }
+
+    // # of branches cut by constraints in last count()
+    long long getPruneCount() const
+    {
+        return prune_cnt;
+    }
+};
+
+#endif
\ No newline at end of file
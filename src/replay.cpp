@@ -0,0 +1,224 @@
+#include "common.h"
+#include "designer.hpp"
+#include "solver.hpp"
+#include "replay_log.hpp"
+
+// replay games logged by main --replay
+// usage: replay FILE [--list] [--game G] [--move K] [--repeat N]
+//  FILE only: summary of the log and its slowest moves
+//  --list: one line per game
+//  --game: solve game G again move by move, with the options
+//   of the run, and compare moves and times with the log
+//  --move: solve move K of game G again N times (default 1),
+//   run it under a profiler to see where the move spends time
+// the Designer is fed the steps and flags of the log,
+//  so a replay follows the recorded game even if it diverges
+// each run of --move replays moves before K first to rebuild
+//  the state of the Solver (partitions, cache, random
+//  generator), only move K is timed
+
+struct Replayer
+{
+    const ReplayOptions &options;
+    const GameRecord &game;
+    Designer designer;
+    Solver solver;
+
+    Replayer(const ReplayOptions &options, const GameRecord &game)
+        : options(options), game(game),
+          designer(game.width, game.height, game.mine_number, game.seed),
+          solver(splitMix64(game.seed))
+    {
+        solver.setThreads(options.solver_thread_num);
+        solver.setCacheLimit(options.cache_mb << 20);
+        solver.setTimeBudget(options.budget_us / 1e6);
+        solver.setSampling(options.sample_us / 1e6);
+        solver.setSampleThreshold(options.sample_above);
+        solver.setLookahead(options.lookahead_us / 1e6,
+                            options.lookahead_depth);
+        designer.initBoard();
+        designer.loadMines(game.mines);
+        if (options.mode == INCREMENTAL)
+            solver.newGame(game.height, game.width, game.mine_number);
+    }
+
+    // pass board of next move to the solver and solve it
+    //  return time of solve() in ns
+    long long solveMove()
+    {
+        if (options.mode == INCREMENTAL)
+            solver.updateBoard(designer.popChanges());
+        else
+            solver.readBoard(designer.getBoard(), game.mine_number);
+        Timer timer;
+        solver.solve();
+        return timer.elapsedNs();
+    }
+
+    // apply recorded move k to the board
+    void applyMove(int k)
+    {
+        const auto &move = game.moves[k];
+        if (designer.clickBoard(k == 0, move.steps))
+            return;
+        designer.putFlag(move.flags);
+    }
+
+    bool sameAsLog(int k) const
+    {
+        return solver.getNextSteps() == game.moves[k].steps &&
+               solver.getNextFlags() == game.moves[k].flags;
+    }
+};
+
+void printSummary(ReplayReader &reader, bool list)
+{
+    struct Slow
+    {
+        long long ns;
+        unsigned long long game;
+        int move;
+        bool operator<(const Slow &other) const { return ns > other.ns; }
+    };
+    static const int TOP = 10;
+    vector<Slow> slowest;
+    long long game_cnt = 0, win_cnt = 0, move_cnt = 0, total_ns = 0;
+    GameRecord game;
+    if (list)
+        std::cout << "game seed size mines win moves solve(ms) slowest(us)\n";
+    while (reader.next(game))
+    {
+        game_cnt++;
+        win_cnt += game.win;
+        long long game_ns = 0;
+        Slow worst{0, game.index, 0};
+        for (int k = 0; k < game.moves.size(); ++k)
+        {
+            long long ns = game.moves[k].solve_ns;
+            game_ns += ns;
+            if (ns > worst.ns)
+                worst = Slow{ns, game.index, k};
+        }
+        move_cnt += game.moves.size();
+        total_ns += game_ns;
+        // keep the slowest move of each game
+        slowest.push_back(worst);
+        std::sort(slowest.begin(), slowest.end());
+        if (slowest.size() > TOP)
+            slowest.pop_back();
+        if (list)
+            std::cout << game.index << ' ' << game.seed << ' '
+                      << game.width << 'x' << game.height << ' '
+                      << game.mine_number << ' ' << game.win << ' '
+                      << game.moves.size() << ' ' << game_ns / 1e6 << ' '
+                      << worst.ns / 1e3 << " (move " << worst.move << ")\n";
+    }
+    std::cout << "games: " << game_cnt << " wins: " << win_cnt
+              << " moves: " << move_cnt
+              << " solve time: " << total_ns / 1e9 << "s\n"
+              << "slowest moves (us game move):\n";
+    for (const auto &it : slowest)
+        std::cout << "  " << it.ns / 1e3 << ' ' << it.game
+                  << ' ' << it.move << '\n';
+    std::cout << std::flush;
+}
+
+// replay all moves of game
+//  return # of moves differing from the log
+int replayGame(const ReplayOptions &options, const GameRecord &game)
+{
+    Replayer replayer(options, game);
+    int diff_cnt = 0;
+    std::cout << "move log(us) replay(us) steps flags same\n";
+    for (int k = 0; k < game.moves.size(); ++k)
+    {
+        long long ns = replayer.solveMove();
+        bool same = replayer.sameAsLog(k);
+        diff_cnt += !same;
+        std::cout << k << ' ' << game.moves[k].solve_ns / 1e3 << ' '
+                  << ns / 1e3 << ' ' << game.moves[k].steps.size() << ' '
+                  << game.moves[k].flags.size() << ' '
+                  << (same ? "yes" : "NO") << '\n';
+        replayer.applyMove(k);
+    }
+    std::cout << diff_cnt << " move(s) differ from the log" << std::endl;
+    return diff_cnt;
+}
+
+// solve move k of game repeat times
+void replayMove(const ReplayOptions &options, const GameRecord &game,
+                int k, int repeat)
+{
+    vector<long long> times;
+    Timer prefix_timer;
+    long long prefix_ns = 0;
+    bool same = true;
+    for (int r = 0; r < repeat; ++r)
+    {
+        Replayer replayer(options, game);
+        prefix_timer.reset();
+        for (int t = 0; t < k; ++t)
+        {
+            replayer.solveMove();
+            replayer.applyMove(t);
+        }
+        prefix_ns += prefix_timer.elapsedNs();
+        times.push_back(replayer.solveMove());
+        same = same && replayer.sameAsLog(k);
+    }
+    std::sort(times.begin(), times.end());
+    std::cout << "game " << game.index << " move " << k
+              << " log " << game.moves[k].solve_ns / 1e3 << "us"
+              << " replay min " << times.front() / 1e3
+              << "us median " << times[times.size() / 2] / 1e3
+              << "us max " << times.back() / 1e3 << "us"
+              << " (moves before it " << prefix_ns / 1e3 / repeat << "us)"
+              << (same ? "" : " differs from the log") << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::ios::sync_with_stdio(false);
+    if (argc < 2)
+        printError("Usage: replay FILE [--list] [--game G] [--move K] [--repeat N]");
+    string file_name = argv[1];
+    bool list = false;
+    long long game_index = -1;
+    int move = -1, repeat = 1;
+    for (int i = 2; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--list")
+            list = true;
+        else if (arg == "--game" && i + 1 < argc)
+            game_index = std::stoll(argv[++i]);
+        else if (arg == "--move" && i + 1 < argc)
+            move = std::stoi(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = max(1, std::stoi(argv[++i]));
+    }
+
+    ReplayReader reader;
+    if (!reader.open(file_name))
+        printError("Not a Replay Log!");
+    std::cout << std::fixed << std::setprecision(2);
+    if (game_index < 0)
+    {
+        printSummary(reader, list);
+        return 0;
+    }
+    GameRecord game;
+    while (reader.next(game))
+        if (game.index == game_index)
+        {
+            if (move < 0)
+                return replayGame(reader.options, game) > 0;
+            if (move >= game.moves.size())
+                printError("Game Has " + std::to_string(game.moves.size()) +
+                           " Moves");
+            replayMove(reader.options, game, move, repeat);
+            return 0;
+        }
+    printError("Game Not Found!");
+    return 0;
+}
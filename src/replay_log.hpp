@@ -0,0 +1,295 @@
+// compact binary log of self-play games for replaying
+#ifndef __REPLAY_LOG_HPP__
+#define __REPLAY_LOG_HPP__
+
+#include "common.h"
+
+// file layout
+//  "AMSR", version byte, then options of the run as varints
+//  version 1 has no options of lookahead
+//  then one record per game: varint length, then the game
+// records are appended as games finish, a file cut by a crash
+//  is readable up to its last complete record
+// numbers are unsigned LEB128 varints, so small ones take a byte
+//  blocks are row-major indices x*width+y, the blocks of a move
+//  are stored as zigzag deltas from the previous one
+//  mines are a bitmap of height*width bits
+// a 30x16 game of about 50 moves takes about 600 bytes
+
+// how Designer and Solver of main.cpp exchange boards
+//  values are stored in logs, so new modes go at the end
+enum Mode
+{
+    MEMORY,
+    FILE_IO,
+    INCREMENTAL,
+    MODE_NUM
+};
+static const char *const MODE_NAME[] = {"memory", "file", "incremental"};
+
+// options of the run that change the moves
+struct ReplayOptions
+{
+    Mode mode = MEMORY;
+    int solver_thread_num = 1;
+    long long cache_mb = 16;
+    long long budget_us = 0;
+    long long sample_us = 0;
+    int sample_above = 0;
+    long long lookahead_us = 0;
+    int lookahead_depth = 1;
+};
+
+// a move: blocks clicked and flagged, and time of solve()
+struct MoveRecord
+{
+    vector<Block> steps, flags;
+    long long solve_ns = 0;
+};
+
+// a game, Designer is seeded with seed and Solver
+//  with splitMix64(seed) as main.cpp does
+struct GameRecord
+{
+    unsigned long long index = 0, seed = 0;
+    int width = 0, height = 0, mine_number = 0;
+    vector<Block> mines;
+    vector<MoveRecord> moves;
+    bool win = false;
+
+    void clear()
+    {
+        mines.clear();
+        moves.clear();
+        win = false;
+    }
+};
+
+inline void putVarint(string &out, unsigned long long x)
+{
+    while (x >= 0x80)
+    {
+        out += (char)(x | 0x80);
+        x >>= 7;
+    }
+    out += (char)x;
+}
+
+// return false at the end of data
+inline bool getVarint(const char *&p, const char *end,
+                      unsigned long long &x)
+{
+    x = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        unsigned char c = *p++;
+        x |= (unsigned long long)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// append record of game to out
+inline void encodeGame(const GameRecord &game, string &out)
+{
+    string body;
+    putVarint(body, game.index);
+    putVarint(body, game.seed);
+    putVarint(body, game.height);
+    putVarint(body, game.width);
+    putVarint(body, game.mine_number);
+    putVarint(body, game.win);
+    string bitmap((game.height * game.width + 7) / 8, 0);
+    for (const auto &it : game.mines)
+    {
+        int k = it.first * game.width + it.second;
+        bitmap[k >> 3] |= 1 << (k & 7);
+    }
+    body += bitmap;
+    putVarint(body, game.moves.size());
+    auto putBlocks = [&](const vector<Block> &blocks)
+    {
+        putVarint(body, blocks.size());
+        long long prev = 0;
+        for (const auto &it : blocks)
+        {
+            long long k = (long long)it.first * game.width + it.second;
+            long long d = k - prev;
+            putVarint(body, (unsigned long long)(d << 1) ^ (d >> 63));
+            prev = k;
+        }
+    };
+    for (const auto &it : game.moves)
+    {
+        putBlocks(it.steps);
+        putBlocks(it.flags);
+        putVarint(body, it.solve_ns);
+    }
+    putVarint(out, body.size());
+    out += body;
+}
+
+// parse a game from [p, end), return false if it is broken
+inline bool decodeGame(const char *p, const char *end, GameRecord &game)
+{
+    unsigned long long x[6];
+    for (auto &it : x)
+        if (!getVarint(p, end, it))
+            return false;
+    game.clear();
+    game.index = x[0];
+    game.seed = x[1];
+    game.height = x[2];
+    game.width = x[3];
+    game.mine_number = x[4];
+    game.win = x[5];
+    long long cells = (long long)game.height * game.width;
+    if (end - p < (cells + 7) / 8)
+        return false;
+    for (long long k = 0; k < cells; ++k)
+        if (p[k >> 3] >> (k & 7) & 1)
+            game.mines.emplace_back(make_pair(k / game.width, k % game.width));
+    p += (cells + 7) / 8;
+    auto getBlocks = [&](vector<Block> &blocks)
+    {
+        unsigned long long n, z;
+        if (!getVarint(p, end, n) || n > (unsigned long long)cells)
+            return false;
+        long long k = 0;
+        for (unsigned long long i = 0; i < n; ++i)
+        {
+            if (!getVarint(p, end, z))
+                return false;
+            k += (long long)(z >> 1) ^ -(long long)(z & 1);
+            if (k < 0 || k >= cells)
+                return false;
+            blocks.emplace_back(make_pair(k / game.width, k % game.width));
+        }
+        return true;
+    };
+    unsigned long long move_cnt, ns;
+    if (!getVarint(p, end, move_cnt))
+        return false;
+    for (unsigned long long i = 0; i < move_cnt; ++i)
+    {
+        game.moves.emplace_back();
+        auto &it = game.moves.back();
+        if (!getBlocks(it.steps) || !getBlocks(it.flags) ||
+            !getVarint(p, end, ns))
+            return false;
+        it.solve_ns = ns;
+    }
+    return p == end;
+}
+
+const char REPLAY_MAGIC[] = "AMSR";
+const int REPLAY_VERSION = 2;
+
+// writes games to a log file
+//  it is not locked, callers writing from several threads
+//  should write whole records under a lock
+class ReplayWriter
+{
+private:
+    ofstream fout;
+    string buf;
+
+public:
+    // return false if file can not be opened
+    bool open(const string &file_name, const ReplayOptions &options)
+    {
+        fout.open(file_name, std::ios::binary);
+        if (!fout.is_open())
+            return false;
+        buf.assign(REPLAY_MAGIC, 4);
+        buf += (char)REPLAY_VERSION;
+        putVarint(buf, options.mode);
+        putVarint(buf, options.solver_thread_num);
+        putVarint(buf, options.cache_mb);
+        putVarint(buf, options.budget_us);
+        putVarint(buf, options.sample_us);
+        putVarint(buf, options.sample_above);
+        putVarint(buf, options.lookahead_us);
+        putVarint(buf, options.lookahead_depth);
+        fout.write(buf.data(), buf.size());
+        return true;
+    }
+
+    // write records encoded by encodeGame()
+    void write(const string &records)
+    {
+        fout.write(records.data(), records.size());
+    }
+
+    void close()
+    {
+        fout.close();
+    }
+};
+
+// reads games of a log file one by one
+class ReplayReader
+{
+private:
+    ifstream fin;
+    string buf;
+
+    bool readVarint(unsigned long long &x)
+    {
+        x = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            int c = fin.get();
+            if (c == EOF)
+                return false;
+            x |= (unsigned long long)(c & 0x7f) << shift;
+            if (!(c & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+public:
+    ReplayOptions options;
+
+    // return false if file is missing or not a log
+    bool open(const string &file_name)
+    {
+        fin.open(file_name, std::ios::binary);
+        char magic[5];
+        if (!fin.read(magic, 5) || string(magic, 4) != REPLAY_MAGIC ||
+            magic[4] < 1 || magic[4] > REPLAY_VERSION)
+            return false;
+        unsigned long long x[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+        for (int i = 0; i < (magic[4] == 1 ? 6 : 8); ++i)
+            if (!readVarint(x[i]))
+                return false;
+        if (x[0] >= MODE_NUM)
+            return false;
+        options.mode = (Mode)x[0];
+        options.solver_thread_num = x[1];
+        options.cache_mb = x[2];
+        options.budget_us = x[3];
+        options.sample_us = x[4];
+        options.sample_above = x[5];
+        options.lookahead_us = x[6];
+        options.lookahead_depth = x[7];
+        return true;
+    }
+
+    // read next game, return false at the end of file
+    //  or at a broken record
+    bool next(GameRecord &game)
+    {
+        unsigned long long len;
+        if (!readVarint(len))
+            return false;
+        buf.resize(len);
+        if (!fin.read(&buf[0], len))
+            return false;
+        return decodeGame(buf.data(), buf.data() + len, game);
+    }
+};
+
+#endif
@@ -0,0 +1,314 @@
+// estimate mine probability of a partition by sampling
+#ifndef __SAMPLER_HPP__
+#define __SAMPLER_HPP__
+
+#include "common.h"
+#include "propagator.hpp"
+
+// constraints of a partition prepared for sampling
+//  a solution puts between lo[c] and hi[c] mines on vars[c]
+//  (the rest of need[c] is in outside[c])
+// a model is rebuilt for each partition sampled, and its
+//  buffers keep their capacity
+struct SampleModel
+{
+    const Constraints *cons;
+    // constraints of each variable, see buildConstraintIndex()
+    vector<int> con_begin, con_of;
+    vector<int> lo, hi;
+    vector<int> pairs; // constraints with at least 2 variables
+
+    void build(const Constraints &cons)
+    {
+        this->cons = &cons;
+        buildConstraintIndex(cons, con_begin, con_of);
+        lo.clear();
+        hi.clear();
+        pairs.clear();
+        for (int c = 0; c < cons.vars.size(); ++c)
+        {
+            lo.push_back(max(cons.need[c] - cons.outside[c], 0));
+            hi.push_back(cons.need[c]);
+            if (cons.vars[c].size() >= 2)
+                pairs.push_back(c);
+        }
+    }
+
+    // constraints of variable v, read like a const vector
+    FlatLists::List consOf(int v) const
+    {
+        const int *p = con_of.data();
+        return FlatLists::List{p + con_begin[v], p + con_begin[v + 1]};
+    }
+};
+
+// a Markov chain over solutions of a partition
+//  each step proposes to flip a variable, or to swap
+//  two variables of a constraint, and accepts it if all
+//  constraints still hold
+// both moves are symmetric, so solutions are visited
+//  uniformly in the long run, the same weight as counting
+// solutions of tight partitions often differ in a long
+//  run of blocks, so once a sweep a window of connected
+//  variables is also redrawn from all its solutions
+// chains may still get stuck when solutions differ in
+//  more than a window, so they are restarted from new
+//  random solutions, see MineSampler::start(), and the
+//  window may be widened up to MAX_WINDOW
+struct SampleChain
+{
+    // at most window variables are redrawn together
+    static const int WINDOW = 12;
+    static const int MAX_WINDOW = 24;
+    // nodes of enumerate() between checks of time
+    static const int CHECK_NODES = 4096;
+
+    const SampleModel *model;
+    int window_size = WINDOW;
+    std::mt19937 gen;
+    vector<int> value; // 1: mine, 0: safe
+    vector<int> sum;   // mines on vars of each constraint
+    // samples taken, and times each variable is a mine
+    long long sample_cnt;
+    vector<long long> mine_cnt;
+
+    // state of redraw()
+    vector<int> window, pick;
+    vector<int> keep;     // assignment of window before redraw()
+    vector<int> rest;     // window variables not assigned of each constraint
+    vector<char> in_window;
+    long long solution_cnt;
+    // run() stops once time passes stop, even in a redraw()
+    std::chrono::steady_clock::time_point stop;
+    long long node_cnt = 0;
+    bool timeout = false;
+
+    // add d to sum of constraints of v
+    void shift(int v, int d)
+    {
+        for (int c : model->consOf(v))
+            sum[c] += d;
+    }
+
+    // whether constraints of v hold
+    bool check(int v) const
+    {
+        for (int c : model->consOf(v))
+            if (sum[c] < model->lo[c] || sum[c] > model->hi[c])
+                return false;
+        return true;
+    }
+
+    void flip(int v)
+    {
+        int d = value[v] ? -1 : 1;
+        shift(v, d);
+        if (check(v))
+            value[v] ^= 1;
+        else
+            shift(v, -d);
+    }
+
+    void swap(int u, int v)
+    {
+        if (value[u] == value[v])
+            return;
+        if (value[u])
+            std::swap(u, v);
+        // u: safe -> mine, v: mine -> safe
+        shift(u, 1);
+        shift(v, -1);
+        if (check(u) && check(v))
+            value[u] = 1, value[v] = 0;
+        else
+            shift(u, -1), shift(v, 1);
+    }
+
+    // assign window[i..] in all ways, and keep one of
+    //  the solutions uniformly (reservoir sampling)
+    // a window of MAX_WINDOW may have millions of solutions,
+    //  so time is checked every CHECK_NODES nodes
+    void enumerate(int i)
+    {
+        if (timeout)
+            return;
+        if (++node_cnt % CHECK_NODES == 0 &&
+            std::chrono::steady_clock::now() > stop)
+        {
+            timeout = true;
+            return;
+        }
+        if (i == window.size())
+        {
+            if (gen() % ++solution_cnt == 0)
+                for (int j = 0; j < window.size(); ++j)
+                    pick[j] = value[window[j]];
+            return;
+        }
+        int v = window[i];
+        for (int c : model->consOf(v))
+            rest[c]--;
+        for (int val = 0; val <= 1; ++val)
+        {
+            value[v] = val;
+            shift(v, val);
+            bool ok = true;
+            for (int c : model->consOf(v))
+                if (sum[c] > model->hi[c] || sum[c] + rest[c] < model->lo[c])
+                    ok = false;
+            if (ok)
+                enumerate(i + 1);
+            shift(v, -val);
+        }
+        for (int c : model->consOf(v))
+            rest[c]++;
+    }
+
+    // redraw variables connected to v
+    //  from the solutions agreeing with the others
+    //  they are kept if time is up before all are seen
+    void redraw(int v)
+    {
+        window.assign(1, v);
+        in_window[v] = true;
+        for (int i = 0; i < window.size() && window.size() < window_size; ++i)
+            for (int c : model->consOf(window[i]))
+                for (int u : model->cons->vars[c])
+                    if (!in_window[u] && window.size() < window_size)
+                    {
+                        in_window[u] = true;
+                        window.push_back(u);
+                    }
+        keep.clear();
+        for (int u : window)
+        {
+            keep.push_back(value[u]);
+            shift(u, -value[u]);
+            for (int c : model->consOf(u))
+                rest[c]++;
+        }
+        // the current assignment is a solution, so some is picked
+        pick.resize(window.size());
+        solution_cnt = 0;
+        enumerate(0);
+        if (timeout)
+            pick = keep;
+        for (int j = 0; j < window.size(); ++j)
+        {
+            int u = window[j];
+            value[u] = pick[j];
+            shift(u, value[u]);
+            in_window[u] = false;
+            for (int c : model->consOf(u))
+                rest[c]--;
+        }
+    }
+
+    // run burn_cnt sweeps, then sweep_cnt sweeps taking
+    //  a sample after each, var_num steps each sweep
+    // if a window holds the whole partition, a redraw alone is
+    //  a uniform sample, and neither burn-in nor single steps
+    //  are needed
+    // stop early once time passes stop
+    void run(int burn_cnt, int sweep_cnt,
+             std::chrono::steady_clock::time_point stop)
+    {
+        this->stop = stop;
+        timeout = false;
+        const auto &cons = *model->cons;
+        int n = cons.var_num;
+        std::uniform_int_distribution<int> var(0, n - 1);
+        std::uniform_int_distribution<int> pair(0, max((int)model->pairs.size() - 1, 0));
+        redraw(var(gen));
+        bool whole = window.size() == n;
+        if (whole)
+            burn_cnt = 0;
+        for (int s = 0; s < burn_cnt + sweep_cnt; ++s)
+        {
+            if (std::chrono::steady_clock::now() > stop)
+                return;
+            for (int t = 0; t < n && !whole; ++t)
+                if (model->pairs.empty() || (gen() & 1))
+                    flip(var(gen));
+                else
+                {
+                    const auto &vars = cons.vars[model->pairs[pair(gen)]];
+                    int k = vars.size();
+                    int i = gen() % k, j = gen() % (k - 1);
+                    swap(vars[i], vars[j < i ? j : j + 1]);
+                }
+            redraw(var(gen));
+            if (timeout)
+                return;
+            if (s < burn_cnt)
+                continue;
+            sample_cnt++;
+            for (int v = 0; v < n; ++v)
+                mine_cnt[v] += value[v];
+        }
+    }
+};
+
+// starts chains from random solutions
+//  found by depth first search like Propagator::count(),
+//  trying mine or safe first at random
+class MineSampler : public Propagator
+{
+private:
+    std::mt19937 *gen;
+
+    bool search(int k)
+    {
+        if (stopped())
+            return false;
+        node_cnt++;
+        while (k < var_num && value[k] >= 0)
+            k++;
+        if (k == var_num)
+            return true;
+
+        int first = (*gen)() & 1;
+        for (int t = 0; t < 2; ++t)
+        {
+            int val = first ^ t;
+            int mark = trail.size();
+            if (!assign(k, val) || !propagate())
+                prune_cnt++;
+            else if (search(k + 1))
+                return true;
+            pending.clear();
+            undo(mark);
+        }
+        return false;
+    }
+
+public:
+    // set chain to a random solution of model and clear
+    //  its samples, a chain may be started again to leave
+    //  the solutions it is stuck in
+    //  return false if there is none, or time is up
+    bool start(const SampleModel &model, SampleChain &chain)
+    {
+        const auto &cons = *model.cons;
+        chain.model = &model;
+        chain.sample_cnt = 0;
+        chain.mine_cnt.assign(cons.var_num, 0);
+        gen = &chain.gen;
+        bool found = init(cons) && search(0);
+        if (found)
+        {
+            chain.value.assign(value.begin(), value.end());
+            chain.in_window.assign(cons.var_num, false);
+            chain.rest.assign(cons.vars.size(), 0);
+            chain.sum.assign(cons.vars.size(), 0);
+            for (int v = 0; v < cons.var_num; ++v)
+                for (int c : model.consOf(v))
+                    chain.sum[c] += value[v];
+        }
+        pending.clear();
+        undo(0);
+        return found;
+    }
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "server.hpp"
+
+// solver server, see server.hpp for the protocol
+// usage: server [--seed S] [--solver-threads N] [--cache-mb N]
+//               [--budget-ms X] [--lookahead-ms X]
+//               [--lookahead-depth D] [--metrics]
+int main(int argc, char *argv[])
+{
+    std::ios::sync_with_stdio(false);
+    SolverServer server;
+    double lookahead_ms = 0;
+    int lookahead_depth = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--metrics")
+            server.setMetrics(true);
+        else if (i + 1 >= argc)
+            break;
+        else if (arg == "--seed")
+            server.setSeed(std::stoull(argv[++i]));
+        else if (arg == "--solver-threads")
+            server.setSolverThreads(max(1, std::stoi(argv[++i])));
+        else if (arg == "--cache-mb")
+            server.setCacheLimit(max(0LL, std::stoll(argv[++i])) << 20);
+        else if (arg == "--budget-ms")
+            server.setTimeBudget(max(0.0, std::stod(argv[++i])) / 1e3);
+        else if (arg == "--lookahead-ms")
+            lookahead_ms = max(0.0, std::stod(argv[++i]));
+        else if (arg == "--lookahead-depth")
+            lookahead_depth = max(1, std::stoi(argv[++i]));
+    }
+    server.setLookahead(lookahead_ms / 1e3, lookahead_depth);
+    server.run(std::cin, std::cout);
+    return 0;
+}
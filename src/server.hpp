@@ -0,0 +1,326 @@
+// long-running solver speaking a line protocol
+#ifndef __SERVER_HPP__
+#define __SERVER_HPP__
+
+#include "common.h"
+#include "utils.hpp"
+#include "solver.hpp"
+
+#include <cctype>
+#include <climits>
+#include <map>
+#include <memory>
+
+// one request per line, tokens are separated by spaces
+//  new G H W M          start game G on an empty H x W board
+//                       with M mines, G is any integer
+//  board G H W M c...   (re)start game G from a full board,
+//                       H*W types in row-major order as board.txt
+//  delta G N x y t ...  N blocks of game G changed to type t
+//                       flags put by the player included
+//  end G                drop game G
+//  stats G              statistics of game G, see setMetrics()
+//  quit                 stop serving
+// new, board and delta are answered with next moves
+//  ok S x y ... F x y ... E T
+//  S steps to click, then F blocks to put flags on,
+//  E is 0 if time budget ran out and some partitions
+//  were estimated roughly, T is time used in us
+// end is answered with ok, stats with
+//  ok {"move":{...},"game":{...}}
+//  statistics of last move and of the game so far in the
+//  format of SolveStats::toJson(), and bad requests with
+//  error <message>
+// a board has at most Solver::MAX_SIDE rows and columns and
+//  Solver::MAX_CELLS blocks, integers out of long long and unknown types are
+//  bad requests, and a request running out of memory is
+//  answered with an error and drops its game
+// games keep their Solver between requests, so partitions
+//  and cached counts of previous moves are reused
+class SolverServer
+{
+private:
+    std::map<long long, std::unique_ptr<Solver>> games;
+    unsigned long long seed;
+    int solver_thread_num;
+    size_t cache_limit;
+    double time_budget;
+    double lookahead_time;
+    int lookahead_depth;
+    bool metrics;
+    // game of the request being handled, games.end() if none
+    std::map<long long, std::unique_ptr<Solver>>::iterator current;
+
+    // parse integers of line from pos
+    //  return false if there is no more integer
+    //  or it does not fit in long long
+    static bool nextInt(const string &line, size_t &pos, long long &x)
+    {
+        while (pos < line.size() && line[pos] == ' ')
+            pos++;
+        if (pos >= line.size())
+            return false;
+        bool neg = line[pos] == '-';
+        if (neg)
+            pos++;
+        if (pos >= line.size() || !isdigit((unsigned char)line[pos]))
+            return false;
+        x = 0;
+        while (pos < line.size() && isdigit((unsigned char)line[pos]))
+        {
+            int d = line[pos++] - '0';
+            if (x > (LLONG_MAX - d) / 10)
+                return false;
+            x = x * 10 + d;
+        }
+        if (neg)
+            x = -x;
+        return true;
+    }
+
+    Solver &newSolver(long long id)
+    {
+        current = games.emplace(id, nullptr).first;
+        auto &solver = current->second;
+        solver.reset(new Solver(splitMix64(seed + id)));
+        solver->setThreads(solver_thread_num);
+        solver->setCacheLimit(cache_limit);
+        solver->setTimeBudget(time_budget);
+        solver->setLookahead(lookahead_time, lookahead_depth);
+        solver->setMetrics(metrics);
+        return *solver;
+    }
+
+    static void appendBlocks(const vector<Block> &blocks, string &reply)
+    {
+        reply += ' ';
+        reply += std::to_string(blocks.size());
+        for (const auto &it : blocks)
+        {
+            reply += ' ';
+            reply += std::to_string(it.first);
+            reply += ' ';
+            reply += std::to_string(it.second);
+        }
+    }
+
+    static void answer(Solver &solver, string &reply)
+    {
+        solver.solve();
+        reply = "ok";
+        appendBlocks(solver.getNextSteps(), reply);
+        appendBlocks(solver.getNextFlags(), reply);
+        reply += solver.isExact() ? " 1 " : " 0 ";
+        reply += std::to_string((long long)(solver.getTimeUsed() * 1e6));
+    }
+
+    // see handle()
+    bool handleRequest(const string &line, string &reply)
+    {
+        size_t pos = 0;
+        while (pos < line.size() && line[pos] == ' ')
+            pos++;
+        size_t end = line.find(' ', pos);
+        string cmd = line.substr(pos, end == string::npos ? end : end - pos);
+        pos = end == string::npos ? line.size() : end;
+
+        if (cmd == "quit")
+        {
+            reply = "ok";
+            return false;
+        }
+        long long id;
+        if ((cmd != "new" && cmd != "board" &&
+             cmd != "delta" && cmd != "end" && cmd != "stats") ||
+            !nextInt(line, pos, id))
+        {
+            reply = "error bad request " + cmd;
+            return true;
+        }
+
+        if (cmd == "new" || cmd == "board")
+        {
+            long long h, w, m;
+            if (!nextInt(line, pos, h) || !nextInt(line, pos, w) ||
+                !nextInt(line, pos, m) || !Solver::isValidSize(h, w, m))
+            {
+                reply = "error bad size";
+                return true;
+            }
+            if (cmd == "new")
+            {
+                Solver &solver = newSolver(id);
+                solver.newGame(h, w, m);
+                answer(solver, reply);
+                return true;
+            }
+            // one flat buffer, rows are not allocated one by one
+            vector<int> cells(h * w);
+            for (auto &c : cells)
+            {
+                long long t;
+                if (!nextInt(line, pos, t))
+                {
+                    reply = "error incomplete board";
+                    return true;
+                }
+                if (!Solver::isValidType(t))
+                {
+                    reply = "error bad type " + std::to_string(t);
+                    return true;
+                }
+                c = t;
+            }
+            auto it = games.find(id);
+            if (it != games.end())
+                current = it;
+            Solver &solver = it == games.end() ? newSolver(id) : *it->second;
+            solver.readBoard(cells.data(), h, w, m);
+            answer(solver, reply);
+            return true;
+        }
+
+        auto it = games.find(id);
+        if (it == games.end())
+        {
+            reply = "error no game " + std::to_string(id);
+            return true;
+        }
+        if (cmd == "end")
+        {
+            games.erase(it);
+            reply = "ok";
+            return true;
+        }
+        if (cmd == "stats")
+        {
+            reply = "ok {\"move\":" + it->second->getLastStats().toJson() +
+                    ",\"game\":" + it->second->getGameStats().toJson() + '}';
+            return true;
+        }
+        // delta
+        current = it;
+        long long n;
+        if (!nextInt(line, pos, n) || n < 0 ||
+            n > (long long)it->second->getHeight() * it->second->getWidth())
+        {
+            reply = "error bad delta";
+            return true;
+        }
+        vector<Change> changes(n);
+        for (auto &c : changes)
+        {
+            long long x, y, t;
+            if (!nextInt(line, pos, x) || !nextInt(line, pos, y) ||
+                !nextInt(line, pos, t))
+            {
+                reply = "error incomplete delta";
+                return true;
+            }
+            if (x < 0 || x >= it->second->getHeight() ||
+                y < 0 || y >= it->second->getWidth())
+            {
+                reply = "error block out of board";
+                return true;
+            }
+            if (!Solver::isValidType(t))
+            {
+                reply = "error bad type " + std::to_string(t);
+                return true;
+            }
+            c = make_pair(make_pair((int)x, (int)y), (int)t);
+        }
+        it->second->updateBoard(changes);
+        answer(*it->second, reply);
+        return true;
+    }
+
+public:
+    // game G is seeded with splitMix64(seed + G)
+    SolverServer(unsigned long long seed = time(0))
+        : seed(seed), solver_thread_num(1), cache_limit(16 << 20),
+          time_budget(0), lookahead_time(0), lookahead_depth(1),
+          metrics(false)
+    {
+    }
+
+    // seed of games started after this
+    void setSeed(unsigned long long seed)
+    {
+        this->seed = seed;
+    }
+
+    // options of each new Solver, see Solver::setThreads(),
+    //  Solver::setCacheLimit() and Solver::setTimeBudget()
+    void setSolverThreads(int solver_thread_num)
+    {
+        this->solver_thread_num = solver_thread_num;
+    }
+
+    void setCacheLimit(size_t cache_limit)
+    {
+        this->cache_limit = cache_limit;
+    }
+
+    void setTimeBudget(double time_budget)
+    {
+        this->time_budget = time_budget;
+    }
+
+    // look ahead of guesses, see Solver::setLookahead()
+    void setLookahead(double seconds, int depth)
+    {
+        lookahead_time = seconds;
+        lookahead_depth = depth;
+    }
+
+    // record statistics of moves for stats requests
+    void setMetrics(bool metrics)
+    {
+        this->metrics = metrics;
+    }
+
+    // # of running games
+    int gameCount() const
+    {
+        return games.size();
+    }
+
+    // handle one request line
+    //  return false on quit
+    bool handle(const string &line, string &reply)
+    {
+        current = games.end();
+        try
+        {
+            return handleRequest(line, reply);
+        }
+        catch (const std::bad_alloc &)
+        {
+            // the game may be left half updated
+            if (current != games.end())
+                games.erase(current);
+            reply = "error out of memory";
+            return true;
+        }
+    }
+
+    // serve requests until quit or end of input
+    //  replies are flushed one by one
+    void run(std::istream &in, std::ostream &out)
+    {
+        string line, reply;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            bool running = handle(line, reply);
+            out << reply << '\n'
+                << std::flush;
+            if (!running)
+                break;
+        }
+    }
+};
+
+#endif
\ No newline at end of file
@@ -5,6 +5,13 @@ BOARD_HEIGHT = 16
 # # of mines
 TOTAL_MINE = 99
 
+# ask a long-running "server.exe" instead of
+#   running "solver.exe" for every move
+USE_SERVER = False
+# or call "autominesweeper.dll" in this process
+#   see autominesweeper.h
+USE_LIBRARY = False
+
 # display (or not display) debug info
 ALLOW_DEBUG = True
 ALLOW_WARNING = True
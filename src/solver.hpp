@@ -1,5 +1,24 @@
+// minesweeper solver
+#ifndef __SOLVER_HPP__
+#define __SOLVER_HPP__
+
 #include "common.h"
 #include "utils.hpp"
+#include "bitboard.hpp"
+#include "propagator.hpp"
+#include "counter.hpp"
+#include "mask_counter.hpp"
+#include "deducer.hpp"
+#include "thread_pool.hpp"
+#include "partition_cache.hpp"
+#include "sampler.hpp"
+#include "tile_grid.hpp"
+#include "metrics.hpp"
+#include "transposition_table.hpp"
+#include "arena.hpp"
+
+#include <memory>
+#include <tuple>
 
 class Solver
 {
@@ -14,35 +33,212 @@ private:
     int mine_cnt;   // current mine
     int total_mine; // total mine
     int width, height;
-    vector<vector<int>> board;
+    // blocks are unknown unless written, so large boards
+    //  only store tiles around the revealed region
+    TileGrid<int> board;
     vector<Block> next_steps; // click these
     vector<Block> next_flags; // put flags on these
 
     // (1) for known blocks
     // if it has at least one unknown nearby
     //  then it can be one of the borders
-    // true border block also requires board[i][j]<=8
+    // true border block also requires board(i, j)<=8
     // (2) for unknown blocks
     // if it has at least one known nearby
     //  then it is one of the borders
 
-    // whether it has unknown nearby
-    vector<vector<bool>> has_unknown;
-    // whether it has known(not including flag) nearby
-    vector<vector<bool>> has_known;
+    // bit planes of board
+    //  # of unknown, known(not including flag) or flags nearby
+    //  are counted on them
+    BitBoard bits;
+
+    // known blocks whose neighbors changed since last solve()
+    //  only they can produce new safe blocks or mines
+    // all blocks are checked if full_scan is set
+    bool full_scan;
+    vector<Block> dirty;
+    TileGrid<char> is_dirty;
 
     int border_sum; // # of border blocks
     // store independent partitions of borders
     vector<vector<Block>> border_partition;
     vector<Block> not_border; // unknown but not border
     // [i][j]: # of solutions with border[i] and j mines in total
+    //  on solved partitions all counts and their sum over j
+    //  fit in long long, partitions overflowing it stay
+    //  unsolved, see countConstraints()
     vector<vector<long long>> border_cnt;
-    // [i][j][k]: # of solutions with border[i],
+    // [i][j * (size + 1) + k]: # of solutions with border[i],
     //  j th block has a mine and k mines in total
-    vector<vector<vector<long long>>> border_block_cnt;
+    //  one flat table per partition
+    vector<vector<long long>> border_block_cnt;
+    // whether border_cnt[i] is calculated
+    //  solutions are kept until the partition changes
+    vector<bool> border_solved;
+    // whether mine_prob holds local probabilities of border[i]
+    //  they are only calculated again when it changes
+    vector<bool> border_local;
+    // whether border[i] is deduced without finding any block
+    //  it is not deduced again until it changes
+    vector<bool> border_deduced;
+    // whether counts of border[i] overflow long long
+    //  it is sampled or estimated until it changes
+    vector<bool> border_overflow;
+    // constraints of border[i] and estimateCost() of them
+    //  built on first use, var_num is 0 until then
+    vector<Constraints> border_cons;
+    vector<double> border_cost;
+    // buffers of dropped partitions, new partitions take them
+    //  so rebuilding partitions does not allocate
+    vector<vector<Block>> spare_partition;
+    vector<vector<long long>> spare_cnt, spare_block_cnt;
+    vector<Constraints> spare_cons;
+    // index of partition containing this block, -1 if not border
+    TileGrid<int> border_id;
+    // whether border_partition is up to date
+    //  readBoard() invalidates it, updateBoard() maintains it
+    bool partition_valid;
 
     // probability of having MINE
-    vector<vector<double>> mine_prob;
+    //  only meaningful on border blocks
+    TileGrid<double> mine_prob;
+    // probability of unknown blocks which are not border
+    double rest_prob;
+
+    // count solutions of partitions
+    //  by listing them, or by splitting into components
+    struct Engine
+    {
+        Propagator propagator;
+        ComponentCounter counter;
+        MaskCounter mask_counter;
+        MineSampler sampler;
+        // search nodes, pruned branches and partitions
+        //  counted in current solve()
+        long long node_cnt = 0;
+        long long prune_cnt = 0;
+        long long counted_cnt = 0;
+        // counts of last partition overflow long long
+        bool overflow = false;
+    };
+    // one engine per thread, see setThreads()
+    vector<Engine> engines;
+    // certain blocks of new partitions are deduced before
+    //  counting, on the calling thread
+    Deducer deducer;
+    // key of PartitionCache of the partition being counted
+    vector<int> cache_key;
+    // values of the partition being deduced
+    vector<int> deduced_value;
+    // scratch of a move, from readBoard() or updateBoard() to
+    //  the end of solve(), when it is reset
+    Arena arena;
+    size_t scratch_bytes = 0; // used by the last move
+    // partitions larger than this are counted by components
+    //  smaller ones are listed on bit masks, which is faster
+    //  up to about 32 blocks on partitions of real games
+    static const int COUNT_THRESHOLD = 32;
+    // check counts of components against listing, see setVerify()
+    bool verify = false;
+    std::atomic<long long> verify_error{0};
+
+    // counts of partitions in previous moves, see setCacheLimit()
+    PartitionCache cache;
+
+    // partitions are counted in parallel if pool is set
+    std::unique_ptr<ThreadPool> pool;
+    // search trees of partitions larger than this
+    //  are split into subtrees for idle threads to steal
+    static const int SPLIT_THRESHOLD = 40;
+    // set to cancel counting of other partitions
+    std::atomic<bool> cancel{false};
+
+    // a partition counted by threads
+    //  each subtree has its own tables, they are
+    //  merged by the thread finishing the last subtree
+    struct Job
+    {
+        int idx;
+        vector<int> key; // key of PartitionCache
+        vector<Constraints> subs;
+        vector<vector<long long>> cnt;
+        vector<vector<long long>> block_cnt;
+        std::atomic<int> left; // unfinished subtrees
+        bool done;             // all subtrees are finished
+                               //  and their sum fits
+        std::atomic<bool> overflow{false}; // a subtree or the sum overflows
+    };
+
+    // time budget of solve() in seconds, 0 for no limit
+    //  counting stops at deadline, see setTimeBudget()
+    double time_budget = 0;
+    std::chrono::steady_clock::time_point deadline;
+    // result of last solve() does not rely on estimates
+    bool exact = true;
+    double time_used = 0;
+
+    // partitions not counted are sampled for sample_time
+    //  seconds in all, no later than deadline, or until 95%
+    //  confidence intervals of all blocks are within
+    //  sample_tolerance, see setSampling()
+    // partitions larger than sample_threshold are sampled
+    //  without counting, 0 to count all of them
+    double sample_time = 0;
+    double sample_tolerance = 0.01;
+    int sample_threshold = 0;
+    // at least this many chains, one per engine if more
+    static const int MIN_CHAINS = 4;
+    // sweeps of each chain between checks of convergence,
+    //  after BURN_SWEEPS sweeps from its new start
+    static const int ROUND_SWEEPS = 128;
+    static const int BURN_SWEEPS = 128;
+    // batches needed before intervals are trusted
+    static const int MIN_BATCHES = 8;
+    // model and chains of samplePartition(), kept across
+    //  partitions and moves so their buffers are reused
+    SampleModel sample_model;
+    vector<SampleChain> chains;
+    // largest half width of confidence intervals, and
+    //  samples taken in last solve()
+    double sample_error = 0;
+    long long sample_cnt = 0;
+
+    // statistics are only recorded if metrics is set
+    //  stats collects the current move from readBoard() to
+    //  the end of solve(), then it is moved to last_stats
+    //  and added to game_stats, see setMetrics()
+    bool metrics = false;
+    SolveStats stats, last_stats, game_stats;
+
+    // guesses are looked ahead for lookahead_time seconds
+    //  if it is set, see setLookahead()
+    double lookahead_time = 0;
+    int lookahead_depth = 1;
+    int lookahead_breadth = 8;
+    // larger boards are not looked ahead, each board
+    //  after a guess is copied and read by a scout
+    static const int LOOKAHEAD_MAX_CELLS = 1 << 16;
+    // a board after a guess, as evaluated by a scout
+    struct Outlook
+    {
+        double log_weight = 0; // log # of mine layouts
+        double safe = 1;       // chance that the safest block is safe
+        bool progress = false; // some block is certainly safe
+        // guesses worth a lookahead and their mine probability
+        vector<pair<double, Block>> candidates;
+    };
+    // solvers evaluating boards after guesses, one per engine
+    //  they are only created when lookahead is on
+    vector<std::unique_ptr<Solver>> scouts;
+    // outlooks of boards keyed by boardHash(), kept across
+    //  moves, the guess of this move is a board of the last one
+    std::unique_ptr<TranspositionTable<Outlook>> table;
+    // last solve() clicked a block which may be a mine
+    bool guessed = false;
+
+    // random generator of this solver
+    //  each thread should own its solver
+    std::mt19937 gen;
 
 private:
     inline bool inBoard(int x, int y)
@@ -51,45 +247,93 @@ private:
                y >= 0 && y < width;
     }
 
+    // run f as phase of current move
+    //  its time and blocks found are recorded if metrics is set
+    template <class F>
+    void runPhase(Phase phase, F f)
+    {
+        if (!metrics)
+        {
+            f();
+            return;
+        }
+        size_t before = next_steps.size() + next_flags.size();
+        Timer timer;
+        f();
+        stats.phase_ns[phase] += timer.elapsedNs();
+        stats.found[phase] += next_steps.size() + next_flags.size() - before;
+    }
+
+    // unknown block with known neighbors
+    inline bool isBorder(int x, int y)
+    {
+        return board(x, y) == UNKNOWN &&
+               bits.countNear(BitBoard::REVEALED_BIT, x, y) > 0;
+    }
+
+    // sort and remove duplicated blocks
+    template <class V>
+    static void uniqueBlocks(V &blocks)
+    {
+        if (!blocks.empty())
+        {
+            std::sort(blocks.begin(),
+                      blocks.end());
+            blocks.resize(std::unique(blocks.begin(),
+                                      blocks.end()) -
+                          blocks.begin());
+        }
+    }
+
+    // a block whose capacity equals to # of mines nearby
+    //  its unknown neighbors are safe (if there's any)
+    void checkSafe(int i, int j)
+    {
+        if (board(i, j) <= 8 &&
+            bits.countNear(BitBoard::UNKNOWN_BIT, i, j) > 0)
+        {
+            int cnt = bits.countNear(BitBoard::FLAG_BIT, i, j);
+            if (cnt > board(i, j))
+                printWarning("detectSafe() Overflow on (" +
+                             std::to_string(i) + "," +
+                             std::to_string(j) + ")");
+            if (cnt == board(i, j))
+                for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
+                    for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
+                        if (board(x, y) == UNKNOWN)
+                            next_steps.emplace_back(make_pair(x, y));
+        }
+    }
+
+    // a block whose capacity equals to # of unknown blocks + mines
+    //  its unknown neighbors must be mines
+    void checkUnsafe(int i, int j)
+    {
+        int unknown_cnt = bits.countNear(BitBoard::UNKNOWN_BIT, i, j);
+        if (board(i, j) <= 8 && unknown_cnt > 0)
+        {
+            int cnt = bits.countNear(BitBoard::FLAG_BIT, i, j) +
+                      unknown_cnt;
+            if (cnt == board(i, j))
+                for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
+                    for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
+                        if (board(x, y) == UNKNOWN)
+                            next_flags.emplace_back(make_pair(x, y));
+        }
+    }
+
     // detect whether there are some blocks
     //  whose capacity equals to # of mines nearby
     // their unknown neighbors are safe (if there's any)
     void detectSafe()
     {
-        PrefixSum<int> s;
-        vector<vector<int>> w(height,
-                              vector<int>(width, 0));
-        int stat = MINE | FLAG;
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                w[i][j] = !!(board[i][j] & stat);
-        s.initSum(w);
-
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                if (board[i][j] <= 8 && has_unknown[i][j])
-                {
-                    int cnt = s.getSum(max(i - 1, 0),
-                                       max(j - 1, 0),
-                                       min(i + 1, height - 1),
-                                       min(j + 1, width - 1));
-                    if (cnt > board[i][j])
-                        printWarning("detectSafe() Overflow on (" +
-                                     std::to_string(i) + "," +
-                                     std::to_string(j) + ")");
-                    if (cnt == board[i][j])
-                        for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
-                            for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
-                                if (board[x][y] == UNKNOWN)
-                                    next_steps.emplace_back(make_pair(x, y));
-                }
-        if (!next_steps.empty())
+        if (full_scan)
+            bits.findSafe(next_steps);
+        else
         {
-            std::sort(next_steps.begin(),
-                      next_steps.end());
-            next_steps.resize(std::unique(next_steps.begin(),
-                                          next_steps.end()) -
-                              next_steps.begin());
+            for (const auto &it : dirty)
+                checkSafe(it.first, it.second);
+            uniqueBlocks(next_steps);
         }
     }
 
@@ -98,72 +342,80 @@ private:
     // their unknown neighbors must be mines
     void detectUnsafe()
     {
-        PrefixSum<int> s;
-        vector<vector<int>> w(height,
-                              vector<int>(width, 0));
-        int stat = MINE | FLAG | UNKNOWN;
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                w[i][j] = !!(board[i][j] & stat);
-        s.initSum(w);
-
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                if (board[i][j] <= 8 && has_unknown[i][j])
-                {
-                    // int cnt = 0;
-                    // for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
-                    //     for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
-                    //         cnt += !!(board[x][y] & stat);
-                    int cnt = s.getSum(max(i - 1, 0),
-                                       max(j - 1, 0),
-                                       min(i + 1, height - 1),
-                                       min(j + 1, width - 1));
-                    if (cnt == board[i][j])
-                        for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
-                            for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
-                                if (board[x][y] == UNKNOWN)
-                                    next_flags.emplace_back(make_pair(x, y));
-                }
-        if (!next_flags.empty())
+        if (full_scan)
+            bits.findUnsafe(next_flags);
+        else
         {
-            std::sort(next_flags.begin(),
-                      next_flags.end());
-            next_flags.resize(std::unique(next_flags.begin(),
-                                          next_flags.end()) -
-                              next_flags.begin());
+            for (const auto &it : dirty)
+                checkUnsafe(it.first, it.second);
+            uniqueBlocks(next_flags);
         }
     }
 
+    // first unknown block which is not border
+    //  in row-major order, (height, width) if none
+    Block firstNotBorder()
+    {
+        Block first = make_pair(height, width);
+        if (known_cnt + mine_cnt + border_sum < width * height)
+            bits.findFirst(BitBoard::UNKNOWN_BIT, [&](int i, int j)
+                           {
+                               if (border_id(i, j) >= 0)
+                                   return false;
+                               first = make_pair(i, j);
+                               return true; });
+        return first;
+    }
+
     // find next block with minimum mine_prob
+    //  the first one in row-major order if there is a tie
     void randomNext()
     {
-        double min_prob = 1;
         static const double eps = 1e-8;
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                if (board[i][j] == UNKNOWN)
-                    min_prob = min(min_prob,
-                                   mine_prob[i][j]);
-
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                if (board[i][j] == UNKNOWN &&
-                    std::fabs(min_prob -
-                              mine_prob[i][j]) < eps)
+        double min_prob = 1;
+        Block best = make_pair(height, width);
+        for (const auto &part : border_partition)
+            for (const auto &it : part)
+            {
+                double prob = mine_prob(it.first, it.second);
+                if (prob < min_prob - eps ||
+                    (prob < min_prob + eps && it < best))
                 {
-                    next_steps.emplace_back(
-                        make_pair(i, j));
-                    printDebug("Choose a Block with Probability " +
-                               std::to_string(min_prob));
-                    return;
+                    min_prob = min(min_prob, prob);
+                    best = it;
                 }
+            }
+
+        // all unknown blocks which are not border
+        //  share the same probability
+        if (rest_prob < min_prob + eps)
+        {
+            Block first = firstNotBorder();
+            if (first.first < height &&
+                (rest_prob < min_prob - eps || first < best))
+            {
+                min_prob = min(min_prob, rest_prob);
+                best = first;
+            }
+        }
+
+        if (best.first < height && lookahead_time > 0)
+            lookahead(best);
+
+        if (best.first < height)
+        {
+            next_steps.emplace_back(best);
+            guessed = true;
+            if (ALLOW_DEBUG)
+                printDebug("Choose a Block with Probability " +
+                           std::to_string(min_prob));
+        }
 
         // printWarning("Random Step!");
         // vector<Block> points;
         // for (int i = 0; i < height; ++i)
         //     for (int j = 0; j < width; ++j)
-        //         if (board[i][j] == UNKNOWN)
+        //         if (board(i, j) == UNKNOWN)
         //             points.emplace_back(make_pair(i, j));
         // if (points.empty())
         //     printError("No Unknown Blocks But Not Terminate");
@@ -172,383 +424,1488 @@ private:
         // next_steps.emplace_back(points.front());
     }
 
-    // traverse connected borders
-    void dfsPartition(int cur_x, int cur_y,
-                      vector<vector<bool>> &is_border)
+    // guesses worth a lookahead: the safest blocks, at most
+    //  lookahead_breadth of them and within slack of the safest
+    //  the first rest block stands for all rest blocks,
+    //  they share the same probability
+    // sorted by (probability, block)
+    void guessCandidates(vector<pair<double, Block>> &candidates)
     {
-        static const int DIR = 4; // U R D L
-        static const int dx[DIR] = {-1, 0, 1, 0};
-        static const int dy[DIR] = {0, 1, 0, -1};
-
-        is_border[cur_x][cur_y] = false;
-        border_partition.back()
-            .emplace_back(make_pair(cur_x, cur_y));
-
-        for (int i = 0; i < DIR; ++i)
+        static const double slack = 0.1;
+        vector<pair<double, Block>> all;
+        for (const auto &part : border_partition)
+            for (const auto &it : part)
+                all.emplace_back(make_pair(mine_prob(it.first, it.second), it));
+        Block first = firstNotBorder();
+        if (first.first < height)
+            all.emplace_back(make_pair(rest_prob, first));
+        std::sort(all.begin(), all.end());
+        candidates.clear();
+        for (const auto &it : all)
         {
-            int x = cur_x + dx[i];
-            int y = cur_y + dy[i];
-            if (!inBoard(x, y))
-                continue;
-            if (is_border[x][y])
-                dfsPartition(x, y, is_border);
+            if (candidates.size() >= lookahead_breadth ||
+                it.first > all.front().first + slack)
+                break;
+            candidates.push_back(it);
         }
     }
 
-    // divide border into independent set
-    void divideBorder()
+    // log of # of mine layouts on unknown blocks
+    //  all partitions must be counted, -INFINITY if none
+    double logWeight()
     {
-        border_partition.clear();
-        // whether an unknown block is border
-        //  and is set to false after visited
-        auto is_border = vector<vector<bool>>(height,
-                                              vector<bool>(width, false));
-        // all unknown border blocks
-        vector<Block> border_blocks;
-        // find all border blocks
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-                if (board[i][j] == UNKNOWN)
-                {
-                    if (has_known[i][j])
-                    {
-                        is_border[i][j] = true;
-                        border_blocks.emplace_back(
-                            make_pair(i, j));
-                    }
-                    else
-                        not_border.emplace_back(
-                            make_pair(i, j));
-                }
-        // partition connected border
-        border_sum = border_blocks.size();
-        for (const auto &it : border_blocks)
-            if (is_border[it.first][it.second])
-            {
-                border_partition.emplace_back(vector<Block>());
-                dfsPartition(it.first, it.second, is_border);
-                std::sort(border_partition.back().begin(),
-                          border_partition.back().end());
-            }
-        // may find an empty block or mine quickly
-        std::shuffle(border_partition.begin(),
-                     border_partition.end(),
-                     std::mt19937(time(0)));
-        // debug info
+        int unknown_mine = total_mine - mine_cnt;
+        int rest_cnt = width * height - known_cnt -
+                       mine_cnt - border_sum;
+        if (unknown_mine < 0)
+            return -INFINITY;
+        // dist[d]: ways of partitions so far to hold d mines
+        //  divided by exp(log_scale)
+        Dist dist(1, 1, arena), part(arena), sum(arena);
+        long double log_scale = 0;
+        for (int i = 0; i < border_partition.size(); ++i)
         {
-            printDebug("The Number of Border Partition is " +
-                       std::to_string(border_partition.size()));
-            int max_size = 0;
-            for (const auto &it : border_partition)
-                max_size = max(max_size, (int)it.size());
-            printDebug("With Max Size " + std::to_string(max_size));
+            long double scale = scaleDist(border_cnt[i], unknown_mine, part);
+            sum.assign(min(dist.size() + part.size() - 1,
+                           (size_t)unknown_mine + 1),
+                       0);
+            for (int a = 0; a < dist.size(); ++a)
+                for (int b = 0; b < part.size() && a + b < sum.size(); ++b)
+                    sum[a + b] += dist[a] * part[b];
+            long double top = *std::max_element(sum.begin(), sum.end());
+            if (scale == 0 || top == 0)
+                return -INFINITY;
+            for (auto &it : sum)
+                it /= top;
+            log_scale += std::log(scale) + std::log(top);
+            dist.swap(sum);
         }
+        // rest blocks hold the other mines
+        double max_log = -INFINITY;
+        for (int d = 0; d < dist.size(); ++d)
+            if (dist[d] > 0 && unknown_mine - d <= rest_cnt)
+                max_log = max(max_log, logChoose(rest_cnt, unknown_mine - d));
+        if (max_log == -INFINITY)
+            return -INFINITY;
+        long double total = 0;
+        for (int d = 0; d < dist.size(); ++d)
+            if (dist[d] > 0 && unknown_mine - d <= rest_cnt)
+                total += dist[d] * std::exp((long double)(logChoose(rest_cnt, unknown_mine - d) -
+                                                          max_log));
+        return log_scale + max_log + std::log(total);
     }
 
-    // MINE + FLAG should <= known info
-    // MINE + FLAG + UNKNOWN should >= known info
-    bool isFeasible(int cur_x, int cur_y)
+    // hash of a board, unknown blocks add nothing, so
+    //  revealing a block changes it by one cellHash()
+    unsigned long long cellHash(int i, int j, int type) const
     {
-        int stat1 = MINE | FLAG;
-        int stat2 = stat1 | UNKNOWN;
-        for (int x = max(cur_x - 1, 0); x <= min(cur_x + 1, height - 1); ++x)
-            for (int y = max(cur_y - 1, 0); y <= min(cur_y + 1, width - 1); ++y)
-                if (board[x][y] <= 8 && board[x][y] > 0)
-                {
-                    int cnt1 = 0, cnt2 = 0;
-                    for (int i = max(x - 1, 0); i <= min(x + 1, height - 1); ++i)
-                        for (int j = max(y - 1, 0); j <= min(y + 1, width - 1); ++j)
-                        {
-                            cnt1 += !!(board[i][j] & stat1);
-                            cnt2 += !!(board[i][j] & stat2);
-                        }
-                    if (cnt1 > board[x][y] ||
-                        cnt2 < board[x][y])
-                        return false;
-                }
-        return true;
+        return splitMix64(((unsigned long long)i * width + j) << 8 | type);
     }
 
-    // use dfs to search all feasible solutions
-    //  in each border partition
-    // border_partition[idx][k]
-    void dfsBorderMines(int idx, int k,
-                        int cur_mine)
+    unsigned long long boardHash(const vector<int> &cells) const
     {
-        if (k == border_partition[idx].size())
+        unsigned long long hash = splitMix64(1ULL << 63 |
+                                             (unsigned long long)height << 42 |
+                                             (unsigned long long)width << 21 |
+                                             total_mine);
+        for (int k = 0; k < cells.size(); ++k)
+            if (cells[k] != UNKNOWN)
+                hash ^= cellHash(k / width, k % width, cells[k]);
+        return hash;
+    }
+
+    // make this solver a scout of a lookahead ending at stop
+    void startScouting(std::chrono::steady_clock::time_point stop)
+    {
+        time_budget = 1; // only outOfTime() reads it
+        deadline = stop;
+        for (auto &it : engines)
         {
-            for (int i = 0; i < k; ++i)
-            {
-                auto it = border_partition[idx][i];
-                if (board[it.first][it.second] == MINE)
-                    border_block_cnt[idx][i][cur_mine]++;
-            }
-            border_cnt[idx][cur_mine]++;
-            return;
+            it.propagator.setDeadline(stop);
+            it.counter.setDeadline(stop);
+            it.mask_counter.setDeadline(stop);
         }
-
-        Block cur = border_partition[idx][k];
-        int x = cur.first;
-        int y = cur.second;
-
-        board[x][y] = MINE;
-        if (isFeasible(x, y)) // feasible prune
-            dfsBorderMines(idx, k + 1, cur_mine + 1);
-
-        board[x][y] = 0;
-        if (isFeasible(x, y)) // feasible prune
-            dfsBorderMines(idx, k + 1, cur_mine);
-
-        board[x][y] = UNKNOWN;
     }
 
-    // calculate probability inside each partition
-    //  we assume each partition is independent here
-    void calcLocalProb()
+    // count all partitions of the board read before and
+    //  evaluate it for the lookahead of another Solver
+    // return false if time is up
+    bool evaluate(Outlook &outlook)
     {
-        static const double eps = 1e-8;
-        double min_prob = 1;
-        double max_prob = 0;
-
-        int unknown_mine = total_mine - mine_cnt;
-        double avg_prob = (unknown_mine)*1.0 /
-                          (width * height - known_cnt - mine_cnt); // not precise
-        mine_prob = vector<vector<double>>(height,
-                                           vector<double>(width, avg_prob));
-
-        border_block_cnt.clear();
-        border_cnt.clear();
-
-        // use dfs to find all feasible solutions
-        //  and calculate probability inside each partition
+        // scratch of the last evaluation
+        arena.reset();
+        next_steps.clear();
+        next_flags.clear();
+        exact = true;
+        divideBorder();
         for (int i = 0; i < border_partition.size(); ++i)
+            if (!border_solved[i])
+            {
+                solvePartition(i);
+                if (!border_solved[i])
+                    return false;
+            }
+        outlook.log_weight = logWeight();
+        outlook.candidates.clear();
+        outlook.safe = 1;
+        outlook.progress = false;
+        if (outlook.log_weight == -INFINITY)
+            return true;
+        // it is only set by calcGlobalProb() if there are rest blocks
+        rest_prob = 1;
+        calcGlobalProb();
+        if (!exact)
+            return false;
+        outlook.progress = !next_steps.empty();
+        if (!outlook.progress)
         {
-            int cur_size = border_partition[i].size();
-            border_cnt.emplace_back(vector<long long>(cur_size + 1, 0));
-            border_block_cnt.emplace_back(
-                vector<vector<long long>>(cur_size,
-                                          vector<long long>(cur_size + 1, 0)));
+            guessCandidates(outlook.candidates);
+            if (!outlook.candidates.empty())
+                outlook.safe = 1 - outlook.candidates.front().first;
+        }
+        return true;
+    }
 
-            dfsBorderMines(i, 0, 0);
+    // chance to survive a guess on block c of cells and
+    //  depth - 1 more guesses after it, c is safe with
+    //  probability safe and board of cells has hash boardHash()
+    // the numbers c may show are weighted by their layouts, a
+    //  number giving some certainly safe block counts as
+    //  survived, otherwise the safest block or the best of
+    //  the next candidates is guessed
+    // layouts only split safe among the numbers, partitions
+    //  count numbers next to other partitions loosely, so
+    //  they do not add up to safe exactly
+    // boards are evaluated by scout once, see table
+    // return -1 if time is up, cells are restored
+    double scoreGuess(Solver &scout, vector<int> &cells,
+                      unsigned long long hash, double safe,
+                      Block c, int depth)
+    {
+        int k = c.first * width + c.second;
+        int flag = 0, unknown = 0;
+        for (int x = max(c.first - 1, 0); x <= min(c.first + 1, height - 1); ++x)
+            for (int y = max(c.second - 1, 0); y <= min(c.second + 1, width - 1); ++y)
+            {
+                flag += cells[x * width + y] == FLAG;
+                unknown += cells[x * width + y] == UNKNOWN;
+            }
+        unknown--; // c itself
 
-            for (int j = 0; j < cur_size; ++j)
+        // log # of layouts and value of each number
+        vector<pair<double, double>> shown;
+        for (int v = flag; v <= min(8, flag + unknown); ++v)
+        {
+            Outlook outlook;
+            unsigned long long next_hash = hash ^ cellHash(c.first, c.second, v);
+            cells[k] = v;
+            if (!table->find(next_hash, outlook))
             {
-                double prob = 0, total = 0;
-                // # of mine in this partition
-                for (int k = 0; k < cur_size + 1; ++k)
+                scout.readBoard(cells.data(), height, width, total_mine);
+                if (!scout.evaluate(outlook))
                 {
-                    prob += border_block_cnt.back()[j][k];
-                    total += border_cnt.back()[k];
+                    cells[k] = UNKNOWN;
+                    return -1;
                 }
-                prob /= total;
-                min_prob = min(min_prob, prob);
-                max_prob = max(max_prob, prob);
-                auto it = border_partition[i][j];
-                mine_prob[it.first][it.second] = prob;
+                table->insert(next_hash, outlook);
             }
-            // find empty block or mine
-            //  return here to avoid further dfs
-            if (min_prob < eps ||
-                std::fabs(1 - max_prob) < eps)
+            if (outlook.log_weight == -INFINITY)
+                continue;
+            double value = outlook.progress ? 1 : outlook.safe;
+            if (!outlook.progress && depth > 1 && !outlook.candidates.empty())
             {
-                calcProbFinish();
-                return;
+                value = 0;
+                for (const auto &next : outlook.candidates)
+                {
+                    double s = scoreGuess(scout, cells, next_hash, 1 - next.first,
+                                          next.second, depth - 1);
+                    if (s < 0)
+                    {
+                        cells[k] = UNKNOWN;
+                        return -1;
+                    }
+                    value = max(value, s);
+                }
             }
+            shown.emplace_back(make_pair(outlook.log_weight, value));
+        }
+        cells[k] = UNKNOWN;
+
+        double max_log = -INFINITY;
+        for (const auto &it : shown)
+            max_log = max(max_log, it.first);
+        double score = 0, total = 0;
+        for (const auto &it : shown)
+        {
+            double w = std::exp(it.first - max_log);
+            score += w * it.second;
+            total += w;
         }
+        return total > 0 ? safe * score / total : 0;
     }
 
-    // calculate conditional probability
-    //  partitions are not mutually independent
-    void calcGlobalProb()
+    // mine probability is not the chance to win, compare the
+    //  safest blocks by scoreGuess() for lookahead_time seconds
+    //  on threads of the pool if any, best is replaced by the
+    //  candidate surviving most often
+    // candidates not scored in time are skipped, and best is
+    //  kept if it is not scored itself
+    void lookahead(Block &best)
     {
-        static const double eps = 1e-8;
-        static const int border_threshold = 20;
-        double min_prob = 1;
-        double max_prob = 0;
-        int unknown_mine = total_mine - mine_cnt;
-        // if we have few remaining border,
-        //  it is not accurate to assume each partition is independent
-        // then, we can use dynamic programing to calculate solutions
-        //  combining different partitions
-        // moreover, here I assume that when # of unknown blocks
-        //  but not border <= threshold, then it is few enough
-        //  to consider dependency
-        if (not_border.size() > border_threshold)
+        static const double eps = 1e-9;
+        if (!exact || (long long)height * width > LOOKAHEAD_MAX_CELLS)
             return;
-        // calculate solutions in not_border
-        if (!not_border.empty())
-        {
-            border_partition.emplace_back(not_border);
-            int cur_size = not_border.size();
-            border_cnt.emplace_back(vector<long long>(cur_size + 1, 0));
-            border_block_cnt.emplace_back(
-                vector<vector<long long>>(cur_size,
-                                          vector<long long>(cur_size + 1, 0)));
-
-            dfsBorderMines(border_partition.size() - 1,
-                           0, 0);
-        }
-        // calculate conditional probability
         for (int i = 0; i < border_partition.size(); ++i)
+            if (!border_solved[i])
+                return;
+        vector<pair<double, Block>> candidates;
+        guessCandidates(candidates);
+        // best is scored first
+        double best_prob = border_id(best.first, best.second) >= 0
+                               ? mine_prob(best.first, best.second)
+                               : rest_prob;
+        auto pos = std::find(candidates.begin(), candidates.end(),
+                             make_pair(best_prob, best));
+        if (pos != candidates.end())
+            candidates.erase(pos);
+        candidates.insert(candidates.begin(), make_pair(best_prob, best));
+        if (candidates.size() < 2)
+            return;
+
+        auto stop = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(lookahead_time));
+        if (time_budget > 0)
+            stop = min(stop, deadline);
+        if (scouts.size() != engines.size())
         {
-            // f is for dynamic programing
-            // f[i][j]: # of solutions with first i th block
-            //  and j mines in total
-            vector<long long> f(unknown_mine + 1, 0);
-            f[0] = 1;
+            scouts.resize(engines.size());
+            for (auto &it : scouts)
+                if (!it)
+                    it.reset(new Solver(0));
+        }
+        for (auto &it : scouts)
+            it->startScouting(stop);
 
-            for (int T = 0; T < border_partition.size(); ++T)
-                if (i != T)
-                    for (int j = unknown_mine; j >= 0; --j)
-                    {
-                        long long cnt = 0;
-                        for (int k = 0; k <= j; ++k)
-                            if (j - k < border_cnt[T].size())
-                                cnt += f[k] * border_cnt[T][j - k];
-                        f[j] = cnt;
-                    }
+        vector<int> cells(height * width, (int)UNKNOWN);
+        board.forEach([&](int i, int j, int type)
+                      { cells[i * width + j] = type; });
+        unsigned long long hash = boardHash(cells);
+        vector<double> score(candidates.size(), -1);
+        auto run = [&](int t, Solver &scout)
+        {
+            vector<int> own = cells;
+            score[t] = scoreGuess(scout, own, hash, 1 - candidates[t].first,
+                                  candidates[t].second, lookahead_depth);
+        };
+        if (pool)
+        {
+            for (int t = 0; t < candidates.size(); ++t)
+                pool->submit([&, t]
+                             { run(t, *scouts[pool->threadIndex()]); });
+            pool->wait();
+        }
+        else
+            for (int t = 0; t < candidates.size(); ++t)
+                run(t, *scouts[0]);
 
-            int cur_size = border_partition[i].size();
-            for (int j = 0; j < cur_size; ++j)
+        double best_score = score[0];
+        if (best_score < 0)
+            return;
+        for (int t = 1; t < candidates.size(); ++t)
+            if (score[t] > best_score + eps)
             {
-                double prob = 0, total = 0;
-                // when this partition has k mines
-                for (int k = 0; k <= min(unknown_mine, cur_size); ++k)
-                    if (f[unknown_mine - k] != 0)
-                    {
-                        prob += border_block_cnt[i][j][k] *
-                                f[unknown_mine - k];
-                        total += border_cnt[i][k] *
-                                 f[unknown_mine - k];
-                    }
-                prob /= total;
-                min_prob = min(min_prob, prob);
-                max_prob = max(max_prob, prob);
-                auto it = border_partition[i][j];
-                mine_prob[it.first][it.second] = prob;
+                best_score = score[t];
+                best = candidates[t].second;
             }
-        }
-        // try to find some
-        calcProbFinish();
+        printDebug("Lookahead Survives with Probability " +
+                   std::to_string(best_score));
     }
 
-    // calculate probability of having MINE
-    //  on each border block
-    void calcBorderProb()
+    // traverse border blocks linked by numbers
+    //  two unknown blocks are linked if a number is next to
+    //  both of them, so no number touches two partitions and
+    //  their solutions are truly independent
+    // blocks of the partition serve as the queue,
+    //  so long borders of large boards need no recursion
+    void dfsPartition(int start_x, int start_y)
     {
-        divideBorder();
-        if (border_partition.empty())
-            printWarning("No Border!");
-
-        calcLocalProb();
-        if (!next_steps.empty() ||
-            !next_flags.empty())
-            return;
-
-        calcGlobalProb();
+        int id = border_partition.size() - 1;
+        auto &part = border_partition.back();
+        border_id.at(start_x, start_y) = id;
+        part.emplace_back(make_pair(start_x, start_y));
+        for (int k = 0; k < part.size(); ++k)
+        {
+            int cur_x = part[k].first, cur_y = part[k].second;
+            // bit planes are padded, so no bound checks
+            for (int i = cur_x - 1; i <= cur_x + 1; ++i)
+                for (int j = cur_y - 1; j <= cur_y + 1; ++j)
+                {
+                    if (!bits.test(BitBoard::REVEALED_BIT, i, j))
+                        continue;
+                    for (int x = i - 1; x <= i + 1; ++x)
+                        for (int y = j - 1; y <= j + 1; ++y)
+                            if (bits.test(BitBoard::UNKNOWN_BIT, x, y) &&
+                                border_id(x, y) < 0)
+                            {
+                                border_id.at(x, y) = id;
+                                part.emplace_back(make_pair(x, y));
+                            }
+                }
+        }
     }
 
-    // find some empty block or mine
-    void calcProbFinish()
+    // append a value to v, moving in the last one of spare
+    //  if any, its contents are stale but its buffers are kept
+    template <class T>
+    static void reuse(vector<T> &v, vector<T> &spare)
     {
-        static const double eps = 1e-8;
-
-        for (const auto &part : border_partition)
-            for (const auto &it : part)
-            {
-                double prob = mine_prob[it.first][it.second];
-                if (prob < eps) // must not be mine
-                    next_steps.push_back(it);
-                if (std::fabs(1 - prob) < eps) // must be mine
-                    next_flags.push_back(it);
-            }
-        if (!next_steps.empty())
-            printDebug("Find Empty Blocks");
-        if (!next_flags.empty())
-            printDebug("Find Mines");
+        if (spare.empty())
+            v.emplace_back();
+        else
+        {
+            v.emplace_back(std::move(spare.back()));
+            spare.pop_back();
+        }
     }
 
-public:
-    // input types
-    // 0-8: # of mines nearby
-    // 16: unknown
-    // 32: flag
-    // 64: unknown
-    void readBoard(string file_name = "board.txt")
+    // move the last value of v to spare
+    template <class T>
+    static void recycle(vector<T> &v, vector<T> &spare)
     {
-        ifstream fin(file_name);
-        if (!fin.is_open())
-            printError("File Not Found!");
-        fin >> height >> width >> total_mine;
-        board = vector<vector<int>>(height,
-                                    vector<int>(width, 0));
-        has_unknown = vector<vector<bool>>(height,
-                                           vector<bool>(width, false));
-        has_known = vector<vector<bool>>(height,
-                                         vector<bool>(width, false));
-        is_empty = true;
-        known_cnt = mine_cnt = 0;
-        for (int i = 0; i < height; ++i)
-            for (int j = 0; j < width; ++j)
-            {
-                int cur_type;
-                fin >> cur_type;
-                is_empty &= cur_type == UNKNOWN;
-                mine_cnt += cur_type == FLAG;
-                known_cnt += cur_type <= 8;
-                auto &has_what = cur_type == UNKNOWN ? has_unknown
-                                                     : has_known;
-                for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
-                    for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
-                        if (cur_type != FLAG)
-                            has_what[x][y] = true;
-                board[i][j] = cur_type;
-            }
-        fin.close();
+        spare.emplace_back(std::move(v.back()));
+        v.pop_back();
     }
 
-    // print next steps
-    void printNextStep(string file_name = "steps.txt")
+    // append an empty partition with reused buffers
+    void pushPartition()
     {
-        ofstream fout(file_name);
-        if (!fout.is_open())
-            printError("Can't Open Output File!");
-        for (const auto &it : next_steps)
-            fout << it.first << ' ' << it.second << '\n';
-        fout.close();
+        reuse(border_partition, spare_partition);
+        border_partition.back().clear();
+        reuse(border_cnt, spare_cnt);
+        reuse(border_block_cnt, spare_block_cnt);
+        reuse(border_cons, spare_cons);
+        border_cons.back().var_num = 0;
+        border_solved.push_back(false);
+        border_local.push_back(false);
+        border_deduced.push_back(false);
+        border_overflow.push_back(false);
+        border_cost.push_back(0);
     }
 
-    // print flags
-    void printNextFlag(string file_name = "flags.txt")
+    // drop the last partition, keeping its buffers
+    void popPartition()
     {
-        ofstream fout(file_name);
-        if (!fout.is_open())
-            printError("Can't Open Output File!");
-        for (const auto &it : next_flags)
-            fout << it.first << ' ' << it.second << '\n';
-        fout.close();
+        recycle(border_partition, spare_partition);
+        recycle(border_cnt, spare_cnt);
+        recycle(border_block_cnt, spare_block_cnt);
+        recycle(border_cons, spare_cons);
+        border_solved.pop_back();
+        border_local.pop_back();
+        border_deduced.pop_back();
+        border_overflow.pop_back();
+        border_cost.pop_back();
     }
 
-    // calculate next steps
-    void solve()
+    // group unvisited border blocks starting from seeds
+    //  into new partitions
+    void buildPartition(const ArenaVector<Block> &seeds)
     {
-        next_steps.clear();
-        next_flags.clear();
-        // initial click
-        if (is_empty)
-        {
-            next_steps.emplace_back(make_pair(
-                randomInt(0, height - 1), randomInt(0, width - 1)));
+        for (const auto &it : seeds)
+            if (border_id(it.first, it.second) < 0 &&
+                isBorder(it.first, it.second))
+            {
+                pushPartition();
+                dfsPartition(it.first, it.second);
+                std::sort(border_partition.back().begin(),
+                          border_partition.back().end());
+                border_sum += border_partition.back().size();
+            }
+    }
+
+    // divide border into independent set
+    void divideBorder()
+    {
+        if (!partition_valid)
+        {
+            while (!border_partition.empty())
+                popPartition();
+            border_sum = 0;
+            border_id.clear();
+            // all unknown border blocks
+            ArenaVector<Block> border_blocks(arena);
+            // find all border blocks
+            bits.updateCandidate();
+            bits.forEach(BitBoard::CANDIDATE_BIT, [&](int i, int j)
+                         { border_blocks.emplace_back(make_pair(i, j)); });
+            // partition connected border
+            buildPartition(border_blocks);
+            partition_valid = true;
+        }
+        // debug info, strings are not built unless it is shown
+        if (ALLOW_DEBUG)
+        {
+            printDebug("The Number of Border Partition is " +
+                       std::to_string(border_partition.size()));
+            int max_size = 0;
+            for (const auto &it : border_partition)
+                max_size = max(max_size, (int)it.size());
+            printDebug("With Max Size " + std::to_string(max_size));
+        }
+    }
+
+    // rebuild partitions around changed blocks
+    //  a change affects numbers within distance 1
+    //  and their unknown neighbors within distance 2
+    void updateBorder(const ArenaVector<Block> &changed)
+    {
+        ArenaVector<int> drop(arena);
+        ArenaVector<Block> seeds(arena);
+        for (const auto &it : changed)
+        {
+            int i = it.first, j = it.second;
+            for (int x = max(i - 2, 0); x <= min(i + 2, height - 1); ++x)
+                for (int y = max(j - 2, 0); y <= min(j + 2, width - 1); ++y)
+                    if (border_id(x, y) >= 0)
+                        drop.push_back(border_id(x, y));
+            for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
+                for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
+                    if (border_id(x, y) < 0 && isBorder(x, y))
+                        seeds.emplace_back(make_pair(x, y));
+        }
+
+        // keep unchanged partitions with their solutions
+        //  the last partition is moved into the place of
+        //  a dropped one, so work follows the changed region
+        //  rather than the whole border
+        std::sort(drop.rbegin(), drop.rend());
+        drop.resize(std::unique(drop.begin(), drop.end()) - drop.begin());
+        for (int i : drop)
+        {
+            border_sum -= border_partition[i].size();
+            for (const auto &it : border_partition[i])
+            {
+                border_id.set(it.first, it.second, -1);
+                seeds.push_back(it);
+            }
+            int last = border_partition.size() - 1;
+            if (i != last)
+            {
+                border_partition[i].swap(border_partition[last]);
+                border_cnt[i].swap(border_cnt[last]);
+                border_block_cnt[i].swap(border_block_cnt[last]);
+                border_solved[i] = border_solved[last];
+                border_local[i] = border_local[last];
+                border_deduced[i] = border_deduced[last];
+                border_overflow[i] = border_overflow[last];
+                std::swap(border_cons[i], border_cons[last]);
+                border_cost[i] = border_cost[last];
+                for (const auto &it : border_partition[i])
+                    border_id.at(it.first, it.second) = i;
+            }
+            popPartition();
+        }
+
+        buildPartition(seeds);
+    }
+
+    // constraints of border_partition[idx]
+    //  numbers next to it and their unknown neighbors
+    // written into cons, whose buffers are reused
+    // the partition must be sorted
+    void buildConstraints(int idx, Constraints &cons)
+    {
+        const auto &part = border_partition[idx];
+        cons.var_num = part.size();
+        cons.vars.clear();
+        cons.need.clear();
+        cons.outside.clear();
+        ArenaVector<Block> numbers(arena);
+        for (const auto &it : part)
+            for (int x = max(it.first - 1, 0); x <= min(it.first + 1, height - 1); ++x)
+                for (int y = max(it.second - 1, 0); y <= min(it.second + 1, width - 1); ++y)
+                    if (board(x, y) <= 8)
+                        numbers.emplace_back(make_pair(x, y));
+        uniqueBlocks(numbers);
+
+        for (const auto &it : numbers)
+        {
+            cons.vars.addList();
+            int var_cnt = 0;
+            for (int x = max(it.first - 1, 0); x <= min(it.first + 1, height - 1); ++x)
+                for (int y = max(it.second - 1, 0); y <= min(it.second + 1, width - 1); ++y)
+                    if (board(x, y) == UNKNOWN)
+                    {
+                        auto pos = std::lower_bound(part.begin(), part.end(),
+                                                    make_pair(x, y));
+                        if (pos != part.end() && *pos == make_pair(x, y))
+                        {
+                            cons.vars.push(pos - part.begin());
+                            var_cnt++;
+                        }
+                    }
+            int x = it.first, y = it.second;
+            cons.need.push_back(board(x, y) -
+                                bits.countNear(BitBoard::FLAG_BIT, x, y));
+            cons.outside.push_back(bits.countNear(BitBoard::UNKNOWN_BIT, x, y) -
+                                   var_cnt);
+        }
+    }
+
+    // rough log2 of the work to count cons, the # of its
+    //  solutions: a constraint on k variables keeps those of
+    //  their 2^k assignments with the right # of mines, and
+    //  constraints are taken as independent
+    static double estimateCost(const Constraints &cons)
+    {
+        double bits = cons.var_num;
+        for (int c = 0; c < cons.vars.size(); ++c)
+        {
+            int k = cons.vars[c].size();
+            double ways = 0, comb = 1; // C(k, j)
+            for (int j = 0; j <= k; ++j)
+            {
+                if (j >= cons.need[c] - cons.outside[c] && j <= cons.need[c])
+                    ways += comb;
+                comb = comb * (k - j) / (j + 1);
+            }
+            bits -= k - std::log2(max(ways, 1.0));
+        }
+        return max(bits, 0.0);
+    }
+
+    // constraints of border_partition[idx], kept until it changes
+    const Constraints &partitionConstraints(int idx)
+    {
+        if (border_cons[idx].var_num == 0)
+        {
+            buildConstraints(idx, border_cons[idx]);
+            border_cost[idx] = estimateCost(border_cons[idx]);
+        }
+        return border_cons[idx];
+    }
+
+    // count solutions of cons with engine
+    //  large partitions are counted without listing solutions
+    // return false if it is cancelled, or if counts do not fit
+    //  in long long, so tables of solved partitions never
+    //  hold overflowed counts
+    bool countConstraints(const Constraints &cons,
+                          vector<long long> &cnt,
+                          vector<long long> &block_cnt,
+                          Engine &engine)
+    {
+        bool done;
+        engine.counted_cnt++;
+        engine.overflow = false;
+        if (verify || cons.var_num > COUNT_THRESHOLD)
+        {
+            done = engine.counter.count(cons, cnt, block_cnt);
+            engine.overflow = engine.counter.isOverflow();
+            engine.node_cnt += engine.counter.getNodeCount();
+            engine.prune_cnt += engine.counter.getPruneCount();
+        }
+        else
+        {
+            done = engine.mask_counter.count(cons, cnt, block_cnt);
+            engine.node_cnt += engine.mask_counter.getNodeCount();
+            engine.prune_cnt += engine.mask_counter.getPruneCount();
+        }
+
+        if (verify && done)
+        {
+            vector<long long> list_cnt, list_block_cnt;
+            done = engine.propagator.count(cons, list_cnt, list_block_cnt);
+            engine.node_cnt += engine.propagator.getNodeCount();
+            engine.prune_cnt += engine.propagator.getPruneCount();
+            bool same = list_cnt == cnt && list_block_cnt == block_cnt;
+            // and listing on bit masks
+            if (done && cons.var_num <= MaskCounter::MAX_VARS)
+            {
+                vector<long long> mask_cnt, mask_block_cnt;
+                done = engine.mask_counter.count(cons, mask_cnt, mask_block_cnt);
+                same = same && mask_cnt == list_cnt &&
+                       mask_block_cnt == list_block_cnt;
+            }
+            if (done && !same)
+            {
+                verify_error++;
+                printWarning("Counts Mismatch on Partition of Size " +
+                             std::to_string(cons.var_num));
+            }
+        }
+        return done;
+    }
+
+    // search all feasible solutions
+    //  in each border partition
+    // numbers next to it are propagated as constraints:
+    //  MINE + FLAG <= known info <= MINE + FLAG + UNKNOWN
+    // partitions with the same constraints are not searched again
+    // return false if it is stopped or overflows
+    bool dfsBorderMines(int idx)
+    {
+        const Constraints &cons = partitionConstraints(idx);
+        PartitionCache::makeKey(cons, cache_key);
+        if (cache.find(cache_key, border_cnt[idx], border_block_cnt[idx]))
+            return true;
+        if (!countConstraints(cons, border_cnt[idx],
+                              border_block_cnt[idx], engines[0]))
+        {
+            border_overflow[idx] = engines[0].overflow;
+            return false;
+        }
+        cache.insert(cache_key, border_cnt[idx], border_block_cnt[idx]);
+        return true;
+    }
+
+    // deduce certain blocks of partitions not counted yet
+    //  counted ones have their certain blocks found by
+    //  calcProbFinish()
+    // smaller partitions first, stop at the first one with
+    //  certain blocks as calcLocalProb() does
+    // with verify, deduced blocks are checked by counting
+    void deduceBorder()
+    {
+        ArenaVector<int> order(arena);
+        for (int i = 0; i < border_partition.size(); ++i)
+            if (!border_solved[i] && !border_deduced[i])
+                order.push_back(i);
+        // ties in index order as a stable sort, which would
+        //  allocate a buffer
+        std::sort(order.begin(), order.end(), [&](int a, int b)
+                  { return make_pair(border_partition[a].size(), a) <
+                           make_pair(border_partition[b].size(), b); });
+        vector<int> &value = deduced_value;
+        for (int i : order)
+        {
+            const Constraints &cons = partitionConstraints(i);
+            if (deducer.deduce(cons, value) == 0)
+            {
+                border_deduced[i] = true;
+                continue;
+            }
+            const auto &part = border_partition[i];
+            for (int v = 0; v < part.size(); ++v)
+                if (value[v] == 0)
+                    next_steps.push_back(part[v]);
+                else if (value[v] == 1)
+                    next_flags.push_back(part[v]);
+            if (verify)
+                checkDeduced(cons, value);
+            printDebug("Deduce Certain Blocks");
+            break;
+        }
+    }
+
+    // count cons and compare with deduced values
+    void checkDeduced(const Constraints &cons, const vector<int> &value)
+    {
+        vector<long long> cnt, block_cnt;
+        if (!engines[0].propagator.count(cons, cnt, block_cnt))
+            return;
+        long long total = 0;
+        for (long long c : cnt)
+            total += c;
+        int n = cons.var_num;
+        for (int v = 0; v < n; ++v)
+        {
+            if (value[v] < 0)
+                continue;
+            long long mine = 0;
+            for (int k = 0; k <= n; ++k)
+                mine += block_cnt[v * (n + 1) + k];
+            if (mine != value[v] * total)
+            {
+                verify_error++;
+                printWarning("Wrong Deduction on Partition of Size " +
+                             std::to_string(cons.var_num));
+            }
+        }
+    }
+
+    // enumerate solutions of border_partition[idx]
+    //  it stays unsolved if time is up or its counts overflow,
+    //  then it is sampled or estimated
+    void solvePartition(int idx)
+    {
+        border_solved[idx] = dfsBorderMines(idx);
+    }
+
+    // unsolved partitions, cheaper ones first by estimateCost()
+    //  so the early exit of calcLocalProb() comes after the least
+    //  work, and more of them are solved when time is up
+    // ties go to smaller partitions, then to lower indices
+    ArenaVector<int> cheapestFirst()
+    {
+        ArenaVector<int> order(arena);
+        for (int i = 0; i < border_partition.size(); ++i)
+            if (!border_solved[i] && !border_overflow[i] &&
+                (sample_threshold == 0 ||
+                 border_partition[i].size() <= sample_threshold))
+            {
+                partitionConstraints(i);
+                order.push_back(i);
+            }
+        std::sort(order.begin(), order.end(), [&](int a, int b)
+                  { return std::make_tuple(border_cost[a], border_partition[a].size(), a) <
+                           std::make_tuple(border_cost[b], border_partition[b].size(), b); });
+        return order;
+    }
+
+    // sample solutions of border_partition[idx] with
+    //  several chains, on threads of the pool if any
+    // each round every chain restarts from a new random
+    //  solution and gives a batch of ROUND_SWEEPS samples, so
+    //  chains stuck in different solutions spread the batches
+    // the 95% confidence interval of a block comes from the
+    //  spread of means of all batches (normal approximation)
+    // a block that never changed within a chain may be stuck
+    //  or certain, so after a round with such blocks the window
+    //  of chains is widened once and earlier batches are dropped
+    // until such a block stays frozen for MIN_BATCHES batches
+    //  of the wide window it is not trusted, and gets
+    //  3 / # of batches (rule of three) instead
+    // rounds run until at least MIN_BATCHES batches are taken,
+    //  all blocks are trusted and all intervals are within
+    //  sample_tolerance, or time passes stop
+    // return false if no solution is found in time
+    bool samplePartition(int idx,
+                         std::chrono::steady_clock::time_point stop)
+    {
+        const Constraints &cons = partitionConstraints(idx);
+        const SampleModel &model = sample_model;
+        sample_model.build(cons);
+        int chain_num = max((int)MIN_CHAINS, (int)engines.size());
+        if (chains.size() < chain_num)
+            chains.resize(chain_num);
+        for (int c = 0; c < chain_num; ++c)
+            chains[c].gen.seed(gen());
+        for (auto &it : engines)
+            it.sampler.setDeadline(stop);
+        int window_size = SampleChain::WINDOW;
+
+        auto runChain = [&](int c, Engine &engine)
+        {
+            SampleChain &chain = chains[c];
+            bool started = engine.sampler.start(model, chain);
+            engine.node_cnt += engine.sampler.getNodeCount();
+            engine.prune_cnt += engine.sampler.getPruneCount();
+            chain.window_size = window_size;
+            if (started)
+                chain.run(BURN_SWEEPS, ROUND_SWEEPS, stop);
+            else
+                chain.sample_cnt = 0;
+        };
+        int n = cons.var_num;
+        // sums of batch means and their squares, and
+        //  whether a block changed within a batch
+        ArenaVector<double> sum(n, 0, arena), sqr(n, 0, arena), mean(n, 0, arena);
+        ArenaVector<char> changed(n, false, arena);
+        int batch_cnt = 0;
+        double error;
+        while (true)
+        {
+            for (int c = 0; c < chain_num; ++c)
+                if (pool)
+                    pool->submit([&, c]
+                                 { runChain(c, engines[pool->threadIndex()]); });
+                else
+                    runChain(c, engines[0]);
+            if (pool)
+                pool->wait();
+
+            for (int c = 0; c < chain_num; ++c)
+            {
+                const SampleChain &it = chains[c];
+                if (it.sample_cnt == 0)
+                    continue;
+                batch_cnt++;
+                sample_cnt += it.sample_cnt;
+                for (int v = 0; v < n; ++v)
+                {
+                    double p = it.mine_cnt[v] * 1.0 / it.sample_cnt;
+                    sum[v] += p;
+                    sqr[v] += p * p;
+                    changed[v] |= it.mine_cnt[v] > 0 &&
+                                  it.mine_cnt[v] < it.sample_cnt;
+                }
+            }
+            if (batch_cnt == 0)
+                return false;
+            // frozen blocks are trusted once the wide window
+            //  has not moved them for MIN_BATCHES batches
+            bool trusted = window_size == SampleChain::MAX_WINDOW &&
+                           batch_cnt >= MIN_BATCHES;
+            error = 0;
+            for (int v = 0; v < n; ++v)
+            {
+                mean[v] = sum[v] / batch_cnt;
+                if (!changed[v] && !trusted)
+                    error = max(error, 3.0 / batch_cnt);
+                else if (batch_cnt == 1)
+                    error = 1;
+                else
+                {
+                    double var = max(sqr[v] - sum[v] * mean[v], 0.0) /
+                                 (batch_cnt - 1);
+                    error = max(error, 1.96 * std::sqrt(var / batch_cnt));
+                }
+            }
+            bool frozen = std::count(changed.begin(), changed.end(), true) < n;
+            if ((batch_cnt >= MIN_BATCHES && (!frozen || trusted) &&
+                 error <= sample_tolerance) ||
+                std::chrono::steady_clock::now() > stop)
+                break;
+            if (frozen && window_size < SampleChain::MAX_WINDOW)
+            {
+                window_size = SampleChain::MAX_WINDOW;
+                batch_cnt = 0;
+                std::fill(sum.begin(), sum.end(), 0);
+                std::fill(sqr.begin(), sqr.end(), 0);
+                std::fill(changed.begin(), changed.end(), false);
+            }
+        }
+
+        sample_error = max(sample_error, error);
+        for (int v = 0; v < n; ++v)
+        {
+            const auto &it = border_partition[idx][v];
+            mine_prob.at(it.first, it.second) = mean[v];
+        }
+        return true;
+    }
+
+    // rough probability of blocks in unsolved partitions
+    //  the largest ratio of mines needed to unknown blocks
+    //  among numbers nearby
+    void estimatePartition(int idx)
+    {
+        for (const auto &it : border_partition[idx])
+        {
+            double prob = 0;
+            for (int x = max(it.first - 1, 0); x <= min(it.first + 1, height - 1); ++x)
+                for (int y = max(it.second - 1, 0); y <= min(it.second + 1, width - 1); ++y)
+                    if (board(x, y) <= 8)
+                    {
+                        int need = board(x, y) -
+                                   bits.countNear(BitBoard::FLAG_BIT, x, y);
+                        int unknown = bits.countNear(BitBoard::UNKNOWN_BIT, x, y);
+                        prob = max(prob, need * 1.0 / unknown);
+                    }
+            mine_prob.at(it.first, it.second) = prob;
+        }
+    }
+
+    // whether border_partition[idx] has an empty block or mine
+    //  it must be solved, so the sums below do not overflow
+    bool hasCertain(int idx)
+    {
+        long long total = 0;
+        for (long long it : border_cnt[idx])
+            total += it;
+        if (total == 0)
+            return false;
+        int n = border_partition[idx].size();
+        for (int j = 0; j < n; ++j)
+        {
+            long long cnt = 0;
+            for (int k = 0; k <= n; ++k)
+                cnt += border_block_cnt[idx][j * (n + 1) + k];
+            if (cnt == 0 || cnt == total)
+                return true;
+        }
+        return false;
+    }
+
+    // split search tree of cons into 2^depth subtrees
+    //  by fixing variables with most constraints
+    // a fixed variable is a constraint on itself,
+    //  so counts of subtrees add up to counts of cons
+    vector<Constraints> splitConstraints(const Constraints &cons,
+                                         int depth)
+    {
+        vector<int> degree(cons.var_num, 0);
+        for (int c = 0; c < cons.vars.size(); ++c)
+            for (int v : cons.vars[c])
+                degree[v]++;
+        vector<int> order(cons.var_num);
+        for (int i = 0; i < cons.var_num; ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                         { return degree[a] > degree[b]; });
+
+        vector<Constraints> subs(1 << depth, cons);
+        for (int s = 0; s < subs.size(); ++s)
+            for (int d = 0; d < depth; ++d)
+            {
+                subs[s].vars.addList();
+                subs[s].vars.push(order[d]);
+                subs[s].need.push_back(s >> d & 1);
+                subs[s].outside.push_back(0);
+            }
+        return subs;
+    }
+
+    // count subtree s of job on current thread
+    void runJob(Job &job, int s)
+    {
+        if (cancel)
+            return;
+        Engine &engine = engines[pool->threadIndex()];
+        if (!countConstraints(job.subs[s], job.cnt[s],
+                              job.block_cnt[s], engine))
+        {
+            if (engine.overflow)
+                job.overflow = true;
+            return;
+        }
+        if (--job.left > 0)
+            return;
+
+        // the last subtree merges tables of others
+        //  subtrees which fit may still overflow in sum, then
+        //  the partition stays unsolved
+        int idx = job.idx;
+        border_cnt[idx].swap(job.cnt[0]);
+        border_block_cnt[idx].swap(job.block_cnt[0]);
+        bool ok = true;
+        for (int t = 1; t < job.subs.size(); ++t)
+        {
+            for (int k = 0; k < job.cnt[t].size(); ++k)
+                ok = addCount(border_cnt[idx][k], job.cnt[t][k]) && ok;
+            for (int j = 0; j < job.block_cnt[t].size(); ++j)
+                ok = addCount(border_block_cnt[idx][j], job.block_cnt[t][j]) && ok;
+        }
+        long long total = 0;
+        for (long long it : border_cnt[idx])
+            ok = addCount(total, it) && ok;
+        if (!ok)
+        {
+            job.overflow = true;
+            return;
+        }
+        job.done = true;
+        // other partitions are not needed any more
+        if (hasCertain(idx))
+            cancel = true;
+    }
+
+    // count unsolved partitions on pool
+    //  cancelled partitions stay unsolved
+    void solveParallel()
+    {
+        int depth = 0;
+        while ((1 << depth) < 4 * pool->size() && depth < 8)
+            depth++;
+
+        vector<std::unique_ptr<Job>> jobs;
+        bool found = false;
+        for (int i : cheapestFirst())
+        {
+            const Constraints &cons = partitionConstraints(i);
+            PartitionCache::makeKey(cons, cache_key);
+            if (cache.find(cache_key, border_cnt[i], border_block_cnt[i]))
+            {
+                border_solved[i] = true;
+                found = found || hasCertain(i);
+                continue;
+            }
+            jobs.emplace_back(new Job());
+            Job &job = *jobs.back();
+            job.idx = i;
+            job.key = cache_key;
+            if (cons.var_num > SPLIT_THRESHOLD)
+                job.subs = splitConstraints(cons, depth);
+            else
+                job.subs.push_back(cons);
+            job.cnt.resize(job.subs.size());
+            job.block_cnt.resize(job.subs.size());
+            job.left = job.subs.size();
+            job.done = false;
+        }
+        // cached partitions are enough
+        if (found)
+            return;
+
+        // workers take their own tasks from the back,
+        //  so expensive jobs are submitted first
+        cancel = false;
+        for (int i = (int)jobs.size() - 1; i >= 0; --i)
+            for (int s = 0; s < jobs[i]->subs.size(); ++s)
+            {
+                Job *job = jobs[i].get();
+                pool->submit([this, job, s]
+                             { runJob(*job, s); });
+            }
+        pool->wait();
+        cancel = false;
+        for (const auto &it : jobs)
+        {
+            border_overflow[it->idx] = it->overflow;
+            if (it->done)
+            {
+                border_solved[it->idx] = true;
+                cache.insert(it->key, border_cnt[it->idx],
+                             border_block_cnt[it->idx]);
+            }
+        }
+    }
+
+    // calculate probability inside each partition
+    //  we assume each partition is independent here
+    void calcLocalProb()
+    {
+        static const double eps = 1e-8;
+        double min_prob = 1;
+        double max_prob = 0;
+
+        int unknown_mine = total_mine - mine_cnt;
+        double avg_prob = (unknown_mine)*1.0 /
+                          (width * height - known_cnt - mine_cnt); // not precise
+        rest_prob = avg_prob;
+
+        // use dfs to find all feasible solutions
+        //  and calculate probability inside each partition
+        // partitions solved in previous moves are reused
+        // cheapest partitions first, so that more of them
+        //  are solved when time is up
+        if (pool)
+            solveParallel();
+        else
+            for (int i : cheapestFirst())
+            {
+                solvePartition(i);
+                if (border_solved[i] && hasCertain(i))
+                    break;
+            }
+        bool found = false;
+        ArenaVector<int> fresh(arena);
+        for (int i = 0; i < border_partition.size(); ++i)
+        {
+            int cur_size = border_partition[i].size();
+            // cancelled, not needed any more or out of time
+            //  or unchanged since last move
+            if (!border_solved[i] || border_local[i])
+                continue;
+            border_local[i] = true;
+            fresh.push_back(i);
+
+            for (int j = 0; j < cur_size; ++j)
+            {
+                double prob = 0, total = 0;
+                // # of mine in this partition
+                for (int k = 0; k < cur_size + 1; ++k)
+                {
+                    prob += border_block_cnt[i][j * (cur_size + 1) + k];
+                    total += border_cnt[i][k];
+                }
+                prob /= total;
+                min_prob = min(min_prob, prob);
+                max_prob = max(max_prob, prob);
+                auto it = border_partition[i][j];
+                mine_prob.at(it.first, it.second) = prob;
+            }
+            // find empty block or mine
+            //  stop here to avoid further dfs
+            if (min_prob < eps ||
+                std::fabs(1 - max_prob) < eps)
+                found = true;
+        }
+        if (found)
+            calcProbFinish(fresh);
+    }
+
+    // distribution of mines, in the arena of a move
+    typedef ArenaVector<long double> Dist;
+
+    // mine distribution cnt scaled so that its largest entry is 1
+    //  entries above max_mine are dropped
+    // return the scale, 0 if there is no solution
+    static long double scaleDist(const vector<long long> &cnt, int max_mine,
+                                 Dist &dist)
+    {
+        dist.assign(min((int)cnt.size(), max_mine + 1), 0);
+        long double scale = 0;
+        for (int k = 0; k < dist.size(); ++k)
+            scale = max(scale, (long double)cnt[k]);
+        if (scale > 0)
+            for (int k = 0; k < dist.size(); ++k)
+                dist[k] = cnt[k] / scale;
+        return scale;
+    }
+
+    // scale dist so that its largest entry is 1
+    static void normalizeDist(Dist &dist)
+    {
+        long double scale = 0;
+        for (auto it : dist)
+            scale = max(scale, it);
+        if (scale > 0)
+            for (auto &it : dist)
+                it /= scale;
+    }
+
+    // distribution c of the sum of mines in a and b
+    //  scaled and cut in the same way as scaleDist()
+    static void convolveDist(const Dist &a, const Dist &b,
+                             int max_mine, Dist &c)
+    {
+        c.assign(min(a.size() + b.size() - 1, (size_t)max_mine + 1), 0);
+        for (int i = 0; i < a.size() && i < c.size(); ++i)
+            if (a[i] != 0)
+                for (int j = 0; j < b.size() && i + j < c.size(); ++j)
+                    c[i + j] += a[i] * b[j];
+        normalizeDist(c);
+    }
+
+    // calculate conditional probability
+    //  partitions are not mutually independent,
+    //  they share the total # of mines
+    // unknown blocks which are not border have no constraint,
+    //  rest_cnt of them hold r mines in C(rest_cnt, r) ways
+    // counts are huge on large boards, so distributions are scaled
+    //  and binomial coefficients are calculated in log space
+    // others of each partition are combined from prefix and suffix
+    //  in one pass, so it costs O(border_sum^2) in total
+    void calcGlobalProb()
+    {
+        static const double eps = 1e-8;
+        int unknown_mine = total_mine - mine_cnt;
+        int rest_cnt = width * height - known_cnt -
+                       mine_cnt - border_sum;
+        int part_num = border_partition.size();
+        if (unknown_mine < 0)
+            return;
+
+        ArenaVector<Dist> dist(part_num, Dist(arena), arena);
+        ArenaVector<long double> scale(part_num, 0, arena);
+        for (int i = 0; i < part_num; ++i)
+        {
+            scale[i] = scaleDist(border_cnt[i], unknown_mine, dist[i]);
+            if (scale[i] == 0) // no solution
+                return;
+        }
+
+        // rest[d]: ways of rest blocks to hold unknown_mine - d mines
+        //  d is # of mines on border, at most border_sum
+        // scaled by the largest one in feasible range
+        Dist rest(min(border_sum, unknown_mine) + 1, 0, arena);
+        int lo = max(0, unknown_mine - border_sum);
+        int hi = min(rest_cnt, unknown_mine);
+        if (lo > hi)
+            return;
+        // log C(n, r+1) = log C(n, r) + log((n-r)/(r+1))
+        ArenaVector<double> log_way(hi - lo + 1, 0, arena);
+        log_way[0] = logChoose(rest_cnt, lo);
+        for (int r = lo; r < hi; ++r)
+            log_way[r - lo + 1] = log_way[r - lo] +
+                                  std::log((rest_cnt - r) / (r + 1.0));
+        double max_log = *std::max_element(log_way.begin(), log_way.end());
+        for (int r = lo; r <= hi; ++r)
+            rest[unknown_mine - r] =
+                std::exp((long double)(log_way[r - lo] - max_log));
+
+        // pre[j]: partitions before i have j mines
+        // suffix[i][d]: partitions from i and rest blocks
+        //  have unknown_mine - d mines
+        //  d is at most # of blocks before i
+        // tables take O(B) each, so only suffixes at multiples
+        //  of step are kept, and the others of a step are
+        //  rebuilt from the next kept one into a window of step
+        //  tables when needed, O(sqrt(P) * B) memory in total
+        ArenaVector<int> before(part_num + 1, 0, arena);
+        for (int i = 0; i < part_num; ++i)
+            before[i + 1] = before[i] + border_partition[i].size();
+        auto extend = [&](int i, const Dist &next, Dist &cur)
+        {
+            cur.assign(min(before[i], unknown_mine) + 1, 0);
+            for (int d = 0; d < cur.size(); ++d)
+                for (int k = 0; k < dist[i].size() && d + k < next.size(); ++k)
+                    cur[d] += dist[i][k] * next[d + k];
+            normalizeDist(cur);
+        };
+        int step = max(1, (int)std::sqrt((double)part_num));
+        ArenaVector<Dist> suffix(part_num + 1, Dist(arena), arena);
+        suffix[part_num] = rest;
+        Dist cur(arena), next(rest);
+        for (int i = part_num - 1; i >= 0; --i)
+        {
+            extend(i, next, cur);
+            next.swap(cur);
+            if (i % step == 0)
+                suffix[i] = next;
+            // global correction takes O(P * B) time, local
+            //  probabilities are kept if time is up
+            if (outOfTime())
+            {
+                exact = false;
+                return;
+            }
+        }
+
+        // calculate conditional probability
+        //  mine_prob no longer holds local ones
+        ArenaVector<int> all(part_num, 0, arena);
+        for (int i = 0; i < part_num; ++i)
+        {
+            all[i] = i;
+            border_local[i] = false;
+        }
+        // window[t - base]: suffix of t in (base, end)
+        //  tables are reserved at the largest size, so they are
+        //  not moved to new memory of the arena as they grow
+        ArenaVector<Dist> window(step, Dist(arena), arena);
+        for (auto &it : window)
+            it.reserve(rest.size());
+        Dist pre(1, 1, arena), w(arena);
+        pre.reserve(rest.size());
+        for (int i = 0; i < part_num; ++i)
+        {
+            int base = i - i % step;
+            int end = min(base + step, part_num);
+            if (i == base)
+                for (int t = end - 1; t > i; --t)
+                    extend(t, t + 1 == end ? suffix[end] : window[t + 1 - base],
+                           window[t - base]);
+            // w[k]: weight of this partition having k mines
+            const auto &suf = i + 1 == end ? suffix[end] : window[i + 1 - base];
+            int cur_size = border_partition[i].size();
+            w.assign(dist[i].size(), 0);
+            long double total = 0;
+            for (int k = 0; k < w.size(); ++k)
+            {
+                for (int j = 0; j < pre.size() && j + k < suf.size(); ++j)
+                    w[k] += pre[j] * suf[j + k];
+                total += dist[i][k] * w[k];
+            }
+            if (total == 0)
+                return;
+            for (int j = 0; j < cur_size; ++j)
+            {
+                long double prob = 0;
+                for (int k = 0; k < w.size(); ++k)
+                    if (w[k] != 0)
+                        prob += border_block_cnt[i][j * (cur_size + 1) + k] / scale[i] * w[k];
+                auto it = border_partition[i][j];
+                mine_prob.at(it.first, it.second) = prob / total;
+            }
+            convolveDist(pre, dist[i], unknown_mine, next);
+            pre.swap(next);
+            // the rest keep local probabilities
+            if (outOfTime())
+            {
+                exact = false;
+                return;
+            }
+        }
+
+        // expected # of mines in rest blocks
+        if (rest_cnt > 0)
+        {
+            long double mine = 0, total = 0;
+            for (int j = 0; j < pre.size(); ++j)
+            {
+                mine += pre[j] * rest[j] * (unknown_mine - j);
+                total += pre[j] * rest[j];
+            }
+            if (total > 0)
+                rest_prob = mine / total / rest_cnt;
+        }
+
+        // try to find some
+        calcProbFinish(all);
+        if (rest_cnt > 0 &&
+            (rest_prob < eps || std::fabs(1 - rest_prob) < eps))
+        {
+            not_border.clear();
+            bits.forEach(BitBoard::UNKNOWN_BIT, [&](int i, int j)
+                         {
+                             if (border_id(i, j) < 0)
+                                 not_border.emplace_back(make_pair(i, j)); });
+            auto &blocks = rest_prob < eps ? next_steps : next_flags;
+            blocks.insert(blocks.end(), not_border.begin(), not_border.end());
+        }
+    }
+
+    // calculate probability of having MINE
+    //  on each border block
+    void calcBorderProb()
+    {
+        runPhase(DIVIDE_BORDER, [&]
+                 { divideBorder(); });
+        if (border_partition.empty())
+            printWarning("No Border!");
+        if (metrics)
+            for (const auto &it : border_partition)
+                stats.addPartition(it.size());
+
+        // new partitions often settle without search
+        runPhase(DEDUCE, [&]
+                 { deduceBorder(); });
+        if (!next_steps.empty() ||
+            !next_flags.empty())
+        {
+            if (metrics)
+                stats.deduced_cnt++;
+            return;
+        }
+
+        runPhase(CALC_LOCAL_PROB, [&]
+                 { calcLocalProb(); });
+        if (!next_steps.empty() ||
+            !next_flags.empty())
+            return;
+
+        // out of time or too large to count, guess with
+        //  samples or estimates, global correction needs
+        //  all partitions
+        // sampling shares one deadline, each partition may use
+        //  an equal share of the time left, and time it does
+        //  not use goes to the partitions after it
+        // partitions left after the deadline are estimated
+        bool approx = false;
+        runPhase(ESTIMATE, [&]
+                 {
+                     auto stop = std::chrono::steady_clock::now() +
+                                 std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     std::chrono::duration<double>(sample_time));
+                     if (time_budget > 0)
+                         stop = min(stop, deadline);
+                     int left = std::count(border_solved.begin(),
+                                           border_solved.end(), false);
+                     for (int i = 0; i < border_partition.size(); ++i)
+                         if (!border_solved[i])
+                         {
+                             auto now = std::chrono::steady_clock::now();
+                             if (sample_time <= 0 || now > stop ||
+                                 !samplePartition(i, now + (stop - now) / left))
+                                 estimatePartition(i);
+                             left--;
+                             approx = true;
+                         } });
+        if (approx)
+        {
+            exact = false;
             return;
         }
+        runPhase(CALC_GLOBAL_PROB, [&]
+                 { calcGlobalProb(); });
+    }
+
+    // whether time budget of solve() is used up
+    bool outOfTime() const
+    {
+        return time_budget > 0 &&
+               std::chrono::steady_clock::now() > deadline;
+    }
+
+    // find some empty block or mine
+    //  in solved partitions of parts
+    void calcProbFinish(const ArenaVector<int> &parts)
+    {
+        static const double eps = 1e-8;
+
+        for (int i : parts)
+        {
+            if (!border_solved[i])
+                continue;
+            for (const auto &it : border_partition[i])
+            {
+                double prob = mine_prob(it.first, it.second);
+                if (prob < eps) // must not be mine
+                    next_steps.push_back(it);
+                if (std::fabs(1 - prob) < eps) // must be mine
+                    next_flags.push_back(it);
+            }
+        }
+        if (!next_steps.empty())
+            printDebug("Find Empty Blocks");
+        if (!next_flags.empty())
+            printDebug("Find Mines");
+    }
 
+    // add (d=1) or remove (d=-1) block of type
+    //  from statistics of board
+    void countBlock(int type, int d)
+    {
+        known_cnt += d * (type <= 8);
+        mine_cnt += d * (type == FLAG);
+    }
+
+    // see updateBoard()
+    void applyChanges(const vector<Change> &changes)
+    {
+        ArenaVector<Block> changed(arena);
+        for (const auto &it : changes)
+        {
+            int i = it.first.first, j = it.first.second;
+            if (board(i, j) == it.second)
+                continue;
+            countBlock(board(i, j), -1);
+            board.set(i, j, it.second);
+            bits.setBlock(i, j, board(i, j));
+            countBlock(board(i, j), 1);
+            changed.push_back(it.first);
+            for (int x = max(i - 1, 0); x <= min(i + 1, height - 1); ++x)
+                for (int y = max(j - 1, 0); y <= min(j + 1, width - 1); ++y)
+                    if (!is_dirty(x, y))
+                    {
+                        is_dirty.at(x, y) = true;
+                        dirty.emplace_back(make_pair(x, y));
+                    }
+        }
+        is_empty = known_cnt + mine_cnt == 0;
+        if (partition_valid)
+            updateBorder(changed);
+    }
+
+    // clear board of size height x width
+    //  all blocks are unknown
+    // the other grids are cleared where they are rebuilt,
+    //  so they are only resized here
+    void resetBoard()
+    {
+        board.reset(height, width, UNKNOWN);
+        if (is_dirty.rows() != height || is_dirty.cols() != width)
+        {
+            is_dirty.reset(height, width, false);
+            border_id.reset(height, width, -1);
+            mine_prob.reset(height, width, 0);
+        }
+    }
+
+    // collect statistics of board
+    //  only blocks which are not unknown are visited
+    void initBoard()
+    {
+        bits.init(height, width);
+        bits.fillUnknown();
+        for (const auto &it : dirty)
+            is_dirty.at(it.first, it.second) = false;
+        dirty.clear();
+        full_scan = true;
+        partition_valid = false;
+        known_cnt = mine_cnt = 0;
+        board.forEach([&](int i, int j, int type)
+                      {
+                          bits.setBlock(i, j, type);
+                          countBlock(type, 1); });
+        is_empty = known_cnt + mine_cnt == 0;
+    }
+
+    // deduce next steps of a non-empty board
+    void solveBoard()
+    {
         // detect blocks with sufficient existing mines
         // their remaining must be safe
-        detectSafe();
+        runPhase(DETECT_SAFE, [&]
+                 { detectSafe(); });
 
         // detect blocks with sufficient mines + unknown
         // their remaining must be unsafe
-        detectUnsafe();
+        runPhase(DETECT_UNSAFE, [&]
+                 { detectUnsafe(); });
         if (!next_steps.empty() ||
             !next_flags.empty())
             return;
@@ -558,6 +1915,434 @@ public:
 
         if (next_steps.empty() &&
             next_flags.empty())
-            randomNext();
+            runPhase(RANDOM_NEXT, [&]
+                     { randomNext(); });
+    }
+
+public:
+    Solver(unsigned long long seed = time(0))
+    {
+        setSeed(seed);
+        setThreads(1);
+    }
+
+    // count partitions on thread_num threads
+    //  1 to count them in the calling thread
+    void setThreads(int thread_num)
+    {
+        pool.reset(thread_num > 1 ? new ThreadPool(thread_num) : nullptr);
+        // the calling thread also runs jobs while waiting
+        engines.resize(pool ? thread_num + 1 : 1);
+        for (auto &it : engines)
+        {
+            it.propagator.setStop(&cancel);
+            it.counter.setStop(&cancel);
+            it.mask_counter.setStop(&cancel);
+        }
+    }
+
+    // reset random generator
+    void setSeed(unsigned long long seed)
+    {
+        seedGenerator(gen, seed);
+    }
+
+    // count every partition both by components and by listing
+    //  and compare the results, this is slow
+    void setVerify(bool verify)
+    {
+        this->verify = verify;
     }
-};
\ No newline at end of file
+
+    // limit time of each solve() in seconds, 0 for no limit
+    //  detectSafe() and detectUnsafe() always run, partitions
+    //  not counted in time are estimated roughly
+    void setTimeBudget(double seconds)
+    {
+        time_budget = seconds;
+    }
+
+    // whether last solve() counted all partitions it needed
+    //  false if it guessed with rough estimates
+    bool isExact() const
+    {
+        return exact;
+    }
+
+    // seconds spent in last solve()
+    double getTimeUsed() const
+    {
+        return time_used;
+    }
+
+    // sample partitions not counted in time for at most
+    //  seconds per move in all, or until 95% confidence
+    //  intervals of probabilities are within tolerance
+    //  the time budget also stops sampling
+    // 0 seconds to use rough estimates instead
+    void setSampling(double seconds, double tolerance = 0.01)
+    {
+        sample_time = seconds;
+        sample_tolerance = tolerance;
+    }
+
+    // sample partitions with more blocks than threshold
+    //  instead of counting them, 0 to count all partitions
+    void setSampleThreshold(int threshold)
+    {
+        sample_threshold = threshold;
+    }
+
+    // largest half width of 95% confidence intervals
+    //  of sampled blocks in last solve(), 0 if none
+    double getSampleError() const
+    {
+        return sample_error;
+    }
+
+    // # of samples taken in last solve()
+    long long getSampleCount() const
+    {
+        return sample_cnt;
+    }
+
+    // record time of each phase, search nodes, partition
+    //  sizes and so on, see getLastStats()
+    // it costs a branch per phase when off
+    void setMetrics(bool metrics)
+    {
+        this->metrics = metrics;
+    }
+
+    // statistics of last move, from reading the board
+    //  to the end of solve(), see SolveStats::toJson()
+    const SolveStats &getLastStats() const
+    {
+        return last_stats;
+    }
+
+    // statistics summed over moves since newGame()
+    //  or resetGameStats()
+    const SolveStats &getGameStats() const
+    {
+        return game_stats;
+    }
+
+    // start a new game when boards are read
+    //  by readBoard() instead of newGame()
+    void resetGameStats()
+    {
+        game_stats.clear();
+    }
+
+    // compare the safest blocks before guessing for at most
+    //  seconds, 0 to guess the safest one
+    //  the chance to survive this guess and depth - 1 more is
+    //  calculated from # of layouts behind each number the
+    //  block may show, a number making some block certainly
+    //  safe counts as survived
+    // breadth: # of blocks compared, within 0.1 of the safest
+    // boards met are kept in a transposition table
+    void setLookahead(double seconds, int depth = 1, int breadth = 8)
+    {
+        lookahead_time = seconds;
+        lookahead_depth = max(1, depth);
+        lookahead_breadth = max(1, breadth);
+        if (seconds > 0 && !table)
+            table.reset(new TranspositionTable<Outlook>());
+    }
+
+    // whether last solve() clicked a block which may be a mine
+    bool isGuess() const
+    {
+        return guessed;
+    }
+
+    // boards found in the transposition table of lookahead
+    //  and all boards looked up
+    long long getLookaheadHits() const
+    {
+        return table ? table->getHitCount() : 0;
+    }
+
+    long long getLookaheadProbes() const
+    {
+        return table ? table->getProbeCount() : 0;
+    }
+
+    // memory limit of cached partition counts in bytes
+    //  0 to disable cache
+    void setCacheLimit(size_t limit)
+    {
+        cache.setLimit(limit);
+    }
+
+    // # of partitions found in cache or searched
+    long long getCacheHits() const
+    {
+        return cache.getHitCount();
+    }
+
+    long long getCacheMisses() const
+    {
+        return cache.getMissCount();
+    }
+
+    // bytes of scratch memory used by the last move
+    size_t getScratchBytes() const
+    {
+        return scratch_bytes;
+    }
+
+    // most bytes of scratch memory used by a move
+    size_t getScratchPeak() const
+    {
+        return arena.getPeakBytes();
+    }
+
+    // # of times scratch memory was taken from heap
+    //  it stops growing once moves have reached their peak
+    long long getScratchAllocs() const
+    {
+        return arena.getHeapCount();
+    }
+
+    // # of partitions whose counts mismatch in verify mode
+    long long getVerifyError() const
+    {
+        return verify_error;
+    }
+
+    // a board has at most MAX_SIDE rows and columns and
+    //  MAX_CELLS blocks, so padded sizes fit in int
+    static const long long MAX_SIDE = 1 << 16;
+    static const long long MAX_CELLS = 1 << 26;
+
+    // whether a board of height x width with total_mine mines
+    //  is within the limits above
+    //  other sizes must not reach readBoard() or newGame()
+    static bool isValidSize(long long height, long long width,
+                            long long total_mine)
+    {
+        return height > 0 && width > 0 && total_mine >= 0 &&
+               height <= MAX_SIDE && width <= MAX_SIDE &&
+               height * width <= MAX_CELLS &&
+               total_mine <= height * width;
+    }
+
+    // whether type is one of the input types below
+    //  other values must not reach readBoard() or updateBoard()
+    static bool isValidType(long long type)
+    {
+        return (type >= 0 && type <= 8) || type == MINE ||
+               type == FLAG || type == UNKNOWN;
+    }
+
+    // input types
+    // 0-8: # of mines nearby
+    // 16: unknown
+    // 32: flag
+    // 64: unknown
+    void readBoard(string file_name = "board.txt")
+    {
+        ifstream fin(file_name);
+        if (!fin.is_open())
+            printError("File Not Found!");
+        readBoard(fin);
+        fin.close();
+    }
+
+    // read board in the format of board.txt from a stream
+    //  blocks are parsed one by one and unknown ones are
+    //  not stored, so the whole board is never buffered
+    void readBoard(std::istream &in)
+    {
+        runPhase(READ_BOARD, [&]
+                 {
+                     in >> height >> width >> total_mine;
+                     resetBoard();
+                     int type;
+                     for (int i = 0; i < height; ++i)
+                         for (int j = 0; j < width; ++j)
+                             if (in >> type)
+                                 board.set(i, j, type);
+                     initBoard(); });
+    }
+
+    // read board from memory
+    //  view uses the same types as board.txt
+    void readBoard(const vector<vector<int>> &view,
+                   int total_mine)
+    {
+        runPhase(READ_BOARD, [&]
+                 {
+                     this->total_mine = total_mine;
+                     height = view.size();
+                     width = view.front().size();
+                     resetBoard();
+                     for (int i = 0; i < height; ++i)
+                         for (int j = 0; j < width; ++j)
+                             board.set(i, j, view[i][j]);
+                     initBoard(); });
+    }
+
+    // read board from a row-major buffer of height*width types
+    //  tiles of board are reused across calls
+    void readBoard(const int *cells, int height, int width,
+                   int total_mine)
+    {
+        runPhase(READ_BOARD, [&]
+                 {
+                     this->total_mine = total_mine;
+                     this->height = height;
+                     this->width = width;
+                     resetBoard();
+                     for (int i = 0; i < height; ++i)
+                         for (int j = 0; j < width; ++j)
+                             board.set(i, j, cells[i * width + j]);
+                     initBoard(); });
+    }
+
+    // start a long-lived game on an empty board
+    //  then pass changes of each move to updateBoard()
+    //  statistics of the game are cleared
+    void newGame(int height, int width, int total_mine)
+    {
+        game_stats.clear();
+        runPhase(READ_BOARD, [&]
+                 {
+                     this->height = height;
+                     this->width = width;
+                     this->total_mine = total_mine;
+                     resetBoard();
+                     initBoard(); });
+    }
+
+    // apply blocks changed since last move
+    //  only statistics around changes are updated,
+    //  and partitions far from changes keep their solutions
+    // it assumes steps and flags of last solve() are applied
+    void updateBoard(const vector<Change> &changes)
+    {
+        runPhase(READ_BOARD, [&]
+                 { applyChanges(changes); });
+    }
+
+    int getHeight() const
+    {
+        return height;
+    }
+
+    int getWidth() const
+    {
+        return width;
+    }
+
+    // blocks to click after solve()
+    const vector<Block> &getNextSteps() const
+    {
+        return next_steps;
+    }
+
+    // blocks to put flags on after solve()
+    const vector<Block> &getNextFlags() const
+    {
+        return next_flags;
+    }
+
+    // print next steps
+    void printNextStep(string file_name = "steps.txt")
+    {
+        ofstream fout(file_name);
+        if (!fout.is_open())
+            printError("Can't Open Output File!");
+        for (const auto &it : next_steps)
+            fout << it.first << ' ' << it.second << '\n';
+        fout.close();
+    }
+
+    // print flags
+    void printNextFlag(string file_name = "flags.txt")
+    {
+        ofstream fout(file_name);
+        if (!fout.is_open())
+            printError("Can't Open Output File!");
+        for (const auto &it : next_flags)
+            fout << it.first << ' ' << it.second << '\n';
+        fout.close();
+    }
+
+    // calculate next steps
+    //  counting stops when time budget runs out,
+    //  see isExact() and getTimeUsed()
+    void solve()
+    {
+        Timer timer;
+        if (time_budget > 0)
+        {
+            deadline = std::chrono::steady_clock::now() +
+                       std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double>(time_budget));
+            for (auto &it : engines)
+            {
+                it.propagator.setDeadline(deadline);
+                it.counter.setDeadline(deadline);
+                it.mask_counter.setDeadline(deadline);
+            }
+        }
+        else
+            for (auto &it : engines)
+            {
+                it.propagator.clearDeadline();
+                it.counter.clearDeadline();
+                it.mask_counter.clearDeadline();
+            }
+        exact = true;
+        guessed = false;
+        sample_error = 0;
+        sample_cnt = 0;
+        for (auto &it : engines)
+            it.node_cnt = it.prune_cnt = it.counted_cnt = 0;
+        long long cache_hit = cache.getHitCount();
+        next_steps.clear();
+        next_flags.clear();
+        // initial click
+        if (is_empty)
+            runPhase(RANDOM_NEXT, [&]
+                     { next_steps.emplace_back(make_pair(
+                           randomInt(0, height - 1, gen),
+                           randomInt(0, width - 1, gen))); });
+        else
+            solveBoard();
+
+        // changes of next move start from here
+        for (const auto &it : dirty)
+            is_dirty.at(it.first, it.second) = false;
+        dirty.clear();
+        full_scan = false;
+        scratch_bytes = arena.getUsedBytes();
+        arena.reset();
+        time_used = timer.elapsed();
+
+        if (metrics)
+        {
+            stats.move_cnt = 1;
+            stats.approx_cnt = !exact;
+            stats.total_ns = time_used * 1e9;
+            for (const auto &it : engines)
+            {
+                stats.node_cnt += it.node_cnt;
+                stats.prune_cnt += it.prune_cnt;
+                stats.counted_cnt += it.counted_cnt;
+            }
+            stats.cache_hit = cache.getHitCount() - cache_hit;
+            stats.sample_cnt = sample_cnt;
+            stats.scratch_bytes = scratch_bytes;
+            last_stats = stats;
+            game_stats.merge(stats);
+        }
+        stats.clear();
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+// work-stealing thread pool
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include "common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// each worker has its own deque of tasks
+//  it takes tasks from the back of its own deque,
+//  and steals from the front of others when idle
+// the thread calling wait() helps running tasks
+class ThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    vector<std::thread> threads;
+    vector<std::unique_ptr<Queue>> queues;
+    std::atomic<int> queued;  // tasks in queues
+    std::atomic<int> pending; // tasks not finished
+    std::atomic<int> next_queue;
+    bool quit;
+    std::mutex wake_lock;
+    std::condition_variable wake;
+
+    // pool and index of current thread
+    static const ThreadPool *&currentPool()
+    {
+        static thread_local const ThreadPool *pool = nullptr;
+        return pool;
+    }
+
+    static int &currentIndex()
+    {
+        static thread_local int index = 0;
+        return index;
+    }
+
+    // take a task, own queue first
+    bool take(int self, Task &task)
+    {
+        int n = queues.size();
+        for (int i = 0; i < n; ++i)
+        {
+            int idx = (self + i) % n;
+            Queue &q = *queues[idx];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.tasks.empty())
+                continue;
+            if (idx == self)
+            {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void run(Task &task)
+    {
+        task();
+        task = nullptr;
+        pending--;
+    }
+
+    void workerLoop(int self)
+    {
+        currentPool() = this;
+        currentIndex() = self;
+        Task task;
+        while (true)
+        {
+            if (take(self, task))
+            {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(wake_lock);
+            wake.wait(guard, [&]
+                      { return quit || queued > 0; });
+            if (quit)
+                return;
+        }
+    }
+
+public:
+    ThreadPool(int thread_num)
+        : queued(0), pending(0), next_queue(0), quit(false)
+    {
+        for (int i = 0; i < thread_num; ++i)
+            queues.emplace_back(new Queue());
+        for (int i = 0; i < thread_num; ++i)
+            threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(wake_lock);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto &it : threads)
+            it.join();
+    }
+
+    // # of worker threads
+    int size() const
+    {
+        return threads.size();
+    }
+
+    // index of current thread
+    //  0 ~ size()-1 for workers, size() for other threads
+    int threadIndex() const
+    {
+        return currentPool() == this ? currentIndex() : size();
+    }
+
+    // add a task, tasks may submit more tasks
+    void submit(Task task)
+    {
+        int idx = threadIndex();
+        if (idx == size())
+            idx = next_queue++ % size();
+        pending++;
+        {
+            std::lock_guard<std::mutex> guard(queues[idx]->lock);
+            queues[idx]->tasks.push_back(std::move(task));
+            queued++;
+        }
+        {
+            std::lock_guard<std::mutex> guard(wake_lock);
+        }
+        wake.notify_one();
+    }
+
+    // run tasks until all submitted tasks are finished
+    void wait()
+    {
+        Task task;
+        while (pending > 0)
+            if (take(0, task))
+                run(task);
+            else
+                std::this_thread::yield();
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,125 @@
+// grid of values stored in lazily allocated tiles
+#ifndef __TILE_GRID_HPP__
+#define __TILE_GRID_HPP__
+
+#include "common.h"
+
+#include <memory>
+
+// height x width values split into 32 x 32 tiles
+//  a tile is allocated when a value in it is first written,
+//  others read as fill, so memory follows the touched region
+// tiles are kept by clear(), so grids reused across moves
+//  do not allocate again
+template <class T>
+class TileGrid
+{
+private:
+    static const int SHIFT = 5;
+    static const int SIZE = 1 << SHIFT;
+    static const int MASK = SIZE - 1;
+
+    int height = 0, width = 0;
+    int tile_cols = 0; // # of tiles per row
+    T fill = T();
+    vector<std::unique_ptr<T[]>> tiles; // null if not allocated
+    vector<int> used;                   // indices of allocated tiles
+
+    inline int tileOf(int x, int y) const
+    {
+        return (x >> SHIFT) * tile_cols + (y >> SHIFT);
+    }
+
+    inline static int cellOf(int x, int y)
+    {
+        return (x & MASK) << SHIFT | (y & MASK);
+    }
+
+public:
+    // resize to height x width, all values are fill
+    void reset(int height, int width, T fill)
+    {
+        this->height = height;
+        this->width = width;
+        this->fill = fill;
+        tile_cols = (width + MASK) >> SHIFT;
+        int tile_num = ((height + MASK) >> SHIFT) * tile_cols;
+        if (tiles.size() != tile_num)
+        {
+            tiles.clear();
+            tiles.resize(tile_num);
+            used.clear();
+        }
+        else
+            clear();
+    }
+
+    int rows() const
+    {
+        return height;
+    }
+
+    int cols() const
+    {
+        return width;
+    }
+
+    // set all values to fill, keeping allocated tiles
+    void clear()
+    {
+        for (int t : used)
+            std::fill(tiles[t].get(), tiles[t].get() + SIZE * SIZE, fill);
+    }
+
+    T operator()(int x, int y) const
+    {
+        const T *tile = tiles[tileOf(x, y)].get();
+        return tile ? tile[cellOf(x, y)] : fill;
+    }
+
+    // reference to a value, allocating its tile
+    T &at(int x, int y)
+    {
+        int t = tileOf(x, y);
+        if (!tiles[t])
+        {
+            tiles[t].reset(new T[SIZE * SIZE]);
+            std::fill(tiles[t].get(), tiles[t].get() + SIZE * SIZE, fill);
+            used.push_back(t);
+        }
+        return tiles[t][cellOf(x, y)];
+    }
+
+    void set(int x, int y, T v)
+    {
+        if (v != fill || tiles[tileOf(x, y)])
+            at(x, y) = v;
+    }
+
+    // call f(x, y, v) on each value of allocated tiles
+    //  which is not fill
+    template <class F>
+    void forEach(F f) const
+    {
+        for (int t : used)
+        {
+            int x0 = t / tile_cols * SIZE, y0 = t % tile_cols * SIZE;
+            for (int i = 0; i < SIZE && x0 + i < height; ++i)
+                for (int j = 0; j < SIZE && y0 + j < width; ++j)
+                {
+                    T v = tiles[t][i << SHIFT | j];
+                    if (v != fill)
+                        f(x0 + i, y0 + j, v);
+                }
+        }
+    }
+
+    // bytes of allocated tiles
+    size_t memory() const
+    {
+        return used.size() * SIZE * SIZE * sizeof(T) +
+               tiles.size() * sizeof(tiles[0]);
+    }
+};
+
+#endif
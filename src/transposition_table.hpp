@@ -0,0 +1,79 @@
+// transposition table of boards met in lookahead
+#ifndef __TRANSPOSITION_TABLE_HPP__
+#define __TRANSPOSITION_TABLE_HPP__
+
+#include "common.h"
+
+#include <mutex>
+
+// fixed number of slots indexed by a 64-bit hash of the board
+//  a new entry replaces the old one in its slot, so memory
+//  stays bounded and recent boards are kept
+// the full hash is stored and compared, boards with
+//  different hashes never share an entry
+// threads of a lookahead share the table under a lock,
+//  lookups are far cheaper than evaluating a board
+template <class T>
+class TranspositionTable
+{
+private:
+    struct Slot
+    {
+        unsigned long long key = 0;
+        bool used = false;
+        T value;
+    };
+
+    vector<Slot> slots;
+    std::mutex lock;
+    long long hit_cnt = 0, probe_cnt = 0;
+
+public:
+    // 2^bits slots
+    TranspositionTable(int bits = 14)
+        : slots(1 << bits)
+    {
+    }
+
+    // copy value of key to value
+    //  return false if not found
+    bool find(unsigned long long key, T &value)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        probe_cnt++;
+        const Slot &slot = slots[key & (slots.size() - 1)];
+        if (!slot.used || slot.key != key)
+            return false;
+        hit_cnt++;
+        value = slot.value;
+        return true;
+    }
+
+    void insert(unsigned long long key, const T &value)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Slot &slot = slots[key & (slots.size() - 1)];
+        slot.key = key;
+        slot.used = true;
+        slot.value = value;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto &it : slots)
+            it.used = false;
+    }
+
+    long long getHitCount() const
+    {
+        return hit_cnt;
+    }
+
+    long long getProbeCount() const
+    {
+        return probe_cnt;
+    }
+};
+
+#endif
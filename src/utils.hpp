@@ -9,63 +9,173 @@ const bool ALLOW_WARNING = false;
 // modify this to display (or not display) debug info
 const bool ALLOW_DEBUG = false;
 
-void printWarning(string msg)
+// literals are printed without building a string,
+//  which would allocate even if nothing is shown
+inline void printWarning(const char *msg)
 {
     if (ALLOW_WARNING)
         std::cout << "WARNING: " << msg << std::endl;
 }
 
-void printDebug(string msg)
+inline void printWarning(const string &msg)
+{
+    printWarning(msg.c_str());
+}
+
+inline void printDebug(const char *msg)
 {
     if (ALLOW_DEBUG)
         std::cout << "DEBUG: " << msg << std::endl;
 }
 
-void printError(string msg)
+inline void printDebug(const string &msg)
+{
+    printDebug(msg.c_str());
+}
+
+inline void printError(string msg)
 {
     std::cout << "ERROR: " << msg << std::endl;
     exit(0);
 }
 
 // uniformly random integer from [mn,mx]
-int randomInt(int mn, int mx)
+inline int randomInt(int mn, int mx, std::mt19937 &gen)
 {
     std::uniform_int_distribution<int> dist(mn, mx);
-    static std::mt19937 gen(time(0));
     return dist(gen);
 }
 
-// use prefix sum
-//  to calculate 2D sum in O(1)
-template <class T>
-class PrefixSum
+// seed generator with all 64 bits of seed
+inline void seedGenerator(std::mt19937 &gen,
+                          unsigned long long seed)
+{
+    std::seed_seq seq{(unsigned)seed,
+                      (unsigned)(seed >> 32)};
+    gen.seed(seq);
+}
+
+// splitmix64 hash
+//  derive independent seeds from (seed, index)
+inline unsigned long long splitMix64(unsigned long long x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// log of binomial coefficient C(n, k)
+inline double logChoose(int n, int k)
+{
+    return std::lgamma(n + 1.0) - std::lgamma(k + 1.0) -
+           std::lgamma(n - k + 1.0);
+}
+
+// wall clock timer
+class Timer
 {
 private:
-    vector<vector<T>> s;
+    std::chrono::steady_clock::time_point start;
 
 public:
-    // initialize prefix sum
-    void initSum(const vector<vector<T>> w)
+    Timer() { reset(); }
+
+    void reset()
     {
-        int r = w.size();
-        int c = w.front().size();
-        s = vector<vector<T>>(r + 1,
-                              vector<T>(c + 1, 0));
-        for (int i = 1; i <= r; ++i)
-            for (int j = 1; j <= c; ++j)
-                s[i][j] = w[i - 1][j - 1] +
-                          s[i - 1][j] + s[i][j - 1] -
-                          s[i - 1][j - 1];
+        start = std::chrono::steady_clock::now();
     }
 
-    // up left down right
-    // including boundary
-    T getSum(int u, int l,
-             int d, int r)
+    // elapsed time in nanoseconds
+    long long elapsedNs() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
+    // elapsed time in seconds
+    double elapsed() const
+    {
+        return elapsedNs() * 1e-9;
+    }
+};
+
+// histogram of latencies (in ns)
+//  with 16 buckets per power of two (error < 1/32)
+// histograms can be merged, so each thread may keep its own
+class LatencyHistogram
+{
+private:
+    static const int SUB = 16;
+    static const int SUB_BITS = 4;
+    vector<long long> buckets;
+    long long total;
+    long long max_value;
+    double sum;
+
+    static int bucketOf(long long v)
+    {
+        if (v < SUB)
+            return v < 0 ? 0 : v;
+        int e = SUB_BITS;
+        while (v >> (e + 1))
+            e++;
+        int sub = (v >> (e - SUB_BITS)) & (SUB - 1);
+        return (e - SUB_BITS + 1) * SUB + sub;
+    }
+
+    // middle value of bucket
+    static double valueOf(int idx)
+    {
+        if (idx < SUB)
+            return idx;
+        int e = idx / SUB + SUB_BITS - 1;
+        int sub = idx % SUB;
+        long long width = 1LL << (e - SUB_BITS);
+        return (SUB + sub) * width + width / 2.0;
+    }
+
+public:
+    LatencyHistogram()
+        : buckets(64 * SUB, 0), total(0),
+          max_value(0), sum(0) {}
+
+    void add(long long ns)
+    {
+        buckets[bucketOf(ns)]++;
+        total++;
+        sum += ns;
+        max_value = max(max_value, ns);
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (int i = 0; i < buckets.size(); ++i)
+            buckets[i] += other.buckets[i];
+        total += other.total;
+        sum += other.sum;
+        max_value = max(max_value, other.max_value);
+    }
+
+    long long count() const { return total; }
+    long long maxValue() const { return max_value; }
+    double mean() const { return total ? sum / total : 0; }
+
+    // approximate value at quantile q (0~1)
+    double percentile(double q) const
     {
-        // actual l=l+1 ...
-        return s[d + 1][r + 1] + s[u][l] -
-               s[d + 1][l] - s[u][r + 1];
+        if (total == 0)
+            return 0;
+        long long rank = max(1LL, (long long)std::ceil(q * total));
+        long long cnt = 0;
+        for (int i = 0; i < buckets.size(); ++i)
+        {
+            cnt += buckets[i];
+            if (cnt >= rank)
+                return min(valueOf(i), (double)max_value);
+        }
+        return max_value;
     }
 };
 
@@ -3,6 +3,8 @@ import win32con as con
 import win32api as api
 import time
 import sys
+import subprocess
+import ctypes
 
 from settings import *
 
@@ -48,15 +50,75 @@ def getFlag(file_name="flags.txt"):
     return flags
 
 
-# click blocks in actual board
-def clickBoard(file_name="steps.txt"):
-    steps = []
+# start "server.exe", see server.hpp for the protocol
+def startServer(path="server.exe"):
+    return subprocess.Popen([path], stdin=subprocess.PIPE,
+                            stdout=subprocess.PIPE,
+                            universal_newlines=True, bufsize=1)
+
+
+# send board to server
+# return steps and flags
+def askServer(server, board, game=0):
+    cells = " ".join(str(x) for row in board for x in row)
+    server.stdin.write("board {} {} {} {} {}\n".format(
+        game, BOARD_HEIGHT, BOARD_WIDTH, TOTAL_MINE, cells))
+    server.stdin.flush()
+    reply = server.stdout.readline().split()
+    if not reply or reply[0] != "ok":
+        printError("Server Replied {}".format(" ".join(reply)))
+
+    values = list(map(int, reply[1:]))
+    n = values[0]
+    steps = [values[1 + 2 * i:3 + 2 * i] for i in range(n)]
+    values = values[1 + 2 * n:]
+    flags = [values[1 + 2 * i:3 + 2 * i] for i in range(values[0])]
+    return steps, flags
+
+
+# load "autominesweeper.dll" and create a solver
+# return library and handle of solver
+def loadLibrary(path="autominesweeper.dll"):
+    lib = ctypes.CDLL(path)
+    lib.ams_create.restype = ctypes.c_void_p
+    lib.ams_create.argtypes = [ctypes.c_ulonglong]
+    lib.ams_solve.argtypes = [ctypes.c_void_p] + \
+        [ctypes.POINTER(ctypes.c_int)] + [ctypes.c_int] * 3 + \
+        [ctypes.POINTER(ctypes.c_int), ctypes.c_int,
+         ctypes.POINTER(ctypes.c_int)] * 2
+    return lib, lib.ams_create(int(time.time()))
+
+
+# solve board with library
+# return steps and flags
+def askLibrary(lib, handle, board):
+    size = BOARD_HEIGHT * BOARD_WIDTH
+    cells = (ctypes.c_int * size)(
+        *[x for row in board for x in row])
+    steps = (ctypes.c_int * (2 * size))()
+    flags = (ctypes.c_int * (2 * size))()
+    step_cnt, flag_cnt = ctypes.c_int(), ctypes.c_int()
+    ret = lib.ams_solve(handle, cells, BOARD_HEIGHT, BOARD_WIDTH,
+                        TOTAL_MINE, steps, size, ctypes.byref(step_cnt),
+                        flags, size, ctypes.byref(flag_cnt))
+    if ret != 0:
+        printError("Library Returned {}".format(ret))
+    return [[steps[2 * i], steps[2 * i + 1]]
+            for i in range(step_cnt.value)], \
+        [[flags[2 * i], flags[2 * i + 1]]
+         for i in range(flag_cnt.value)]
 
-    with open(file_name, "r") as f:
-        lines = f.readlines()
-        for line in lines:
-            steps.append(list(
-                map(int, line.split())))
+
+# click blocks in actual board
+# steps are read from file if not given
+def clickBoard(file_name="steps.txt", steps=None):
+    if steps is None:
+        steps = []
+        with open(file_name, "r") as f:
+            lines = f.readlines()
+            for line in lines:
+                steps.append(list(
+                    map(int, line.split())))
 
     handle = gui.FindWindow(None, "Minesweeper")
     left, up, _, _ = gui.GetWindowRect(handle)